@@ -31,6 +31,11 @@ AbstractGame::AbstractGame( const Parameters &params )
     fprintf( stderr, "failed to read game file [%s]\n", params.game_file );
     exit( -1 );
   }
+  if( game->numPlayers > MAX_PURE_CFR_PLAYERS ) {
+    fprintf( stderr, "game has %d players, but at most %d are supported\n",
+	     game->numPlayers, MAX_PURE_CFR_PLAYERS );
+    exit( -1 );
+  }
 
   /* Create action abstraction */
   switch( params.action_abs_type ) {
@@ -40,6 +45,9 @@ AbstractGame::AbstractGame( const Parameters &params )
   case ACTION_ABS_FCPA:
     action_abs = new FcpaActionAbstraction( );
     break;
+  case ACTION_ABS_CONFIGURABLE:
+    action_abs = new ConfigurableActionAbstraction( game, params.action_file );
+    break;
   default:
     fprintf( stderr, "PureCfrMachine constructor: "
 	     "Unrecognized action abstraction type [%s]\n",
@@ -56,7 +64,7 @@ AbstractGame::AbstractGame( const Parameters &params )
   State state;
   initState( game, 0, &state );
   betting_tree_root = init_betting_tree_r( state, game, action_abs,
-					   num_entries_per_bucket );
+					   num_entries_per_bucket, node_actions );
 
   /* Create card abstraction */
   switch( params.card_abs_type ) {
@@ -66,6 +74,12 @@ AbstractGame::AbstractGame( const Parameters &params )
   case CARD_ABS_BLIND:
     card_abs = new BlindCardAbstraction( );
     break;
+  case CARD_ABS_ISOMORPHIC:
+    card_abs = new IsomorphicCardAbstraction( game );
+    break;
+  case CARD_ABS_FILE:
+    card_abs = new FileCardAbstraction( game, params.bucket_file );
+    break;
   default:
     fprintf( stderr, "AbstractGame constructor: "
 	     "Unrecognized card abstraction type [%s]\n",
@@ -128,3 +142,41 @@ void AbstractGame::count_entries( size_t num_entries_per_bucket[ MAX_ROUNDS ],
 {
   count_entries_r( betting_tree_root, num_entries_per_bucket, total_num_entries );
 }
+
+void AbstractGame::count_nodes_r( const BettingNode *node,
+				  size_t num_choice_nodes[ MAX_ROUNDS ],
+				  size_t num_info_sets[ MAX_ROUNDS ],
+				  size_t &num_terminal_nodes,
+				  int &max_num_choices ) const
+{
+  const BettingNode *child = node->get_child( );
+
+  if( child == NULL ) {
+    /* Terminal node */
+    ++num_terminal_nodes;
+    return;
+  }
+
+  const int8_t round = node->get_round( );
+  num_choice_nodes[ round ] += 1;
+  num_info_sets[ round ] += card_abs->num_buckets( game, node );
+  if( node->get_num_choices( ) > max_num_choices ) {
+    max_num_choices = node->get_num_choices( );
+  }
+
+  /* Recurse */
+  while( child != NULL ) {
+    count_nodes_r( child, num_choice_nodes, num_info_sets, num_terminal_nodes,
+		   max_num_choices );
+    child = child->get_sibling( );
+  }
+}
+
+void AbstractGame::count_nodes( size_t num_choice_nodes[ MAX_ROUNDS ],
+				size_t num_info_sets[ MAX_ROUNDS ],
+				size_t &num_terminal_nodes,
+				int &max_num_choices ) const
+{
+  count_nodes_r( betting_tree_root, num_choice_nodes, num_info_sets,
+		 num_terminal_nodes, max_num_choices );
+}
@@ -11,6 +11,7 @@
  */
 
 /* C / C++ / STL indluces */
+#include <vector>
 
 /* project_acpc_server includes */
 extern "C" {
@@ -31,6 +32,16 @@ public:
 
   virtual void count_entries( size_t num_entries_per_bucket[ MAX_ROUNDS ],
 			      size_t total_num_entries[ MAX_ROUNDS ] ) const;
+  /* Also finds the largest number of choices at any node of the tree */
+  virtual void count_nodes( size_t num_choice_nodes[ MAX_ROUNDS ],
+			    size_t num_info_sets[ MAX_ROUNDS ],
+			    size_t &num_terminal_nodes,
+			    int &max_num_choices ) const;
+  /* The abstract actions of an information set node's choices, as found
+   * when the tree was built
+   */
+  const Action *get_node_actions( const BettingNode *node ) const
+  { return &node_actions[ node->get_round( ) ][ node->get_soln_idx( ) ]; }
 
   Game *game;
 
@@ -41,9 +52,17 @@ public:
 
 protected:
 
+  /* Each round's actions, in the same order as the entries of one bucket */
+  std::vector<Action> node_actions[ MAX_ROUNDS ];
+
   void count_entries_r( const BettingNode *node,
 			size_t num_entries_per_bucket[ MAX_ROUNDS ],
 			size_t total_num_entries[ MAX_ROUNDS ] ) const;
+  void count_nodes_r( const BettingNode *node,
+		      size_t num_choice_nodes[ MAX_ROUNDS ],
+		      size_t num_info_sets[ MAX_ROUNDS ],
+		      size_t &num_terminal_nodes,
+		      int &max_num_choices ) const;
 };
 
 #endif
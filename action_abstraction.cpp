@@ -8,6 +8,11 @@
 
 /* C / C++ / STL indluces */
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
 
 /* project_acpc_server includes */
 extern "C" {
@@ -138,3 +143,163 @@ int FcpaActionAbstraction::get_actions( const Game *game,
 
   return num_actions;
 }
+
+ConfigurableActionAbstraction::ConfigurableActionAbstraction( const Game *game,
+							      const char *filename )
+{
+  FILE *file = fopen( filename, "r" );
+  if( file == NULL ) {
+    fprintf( stderr, "Could not open action abstraction file [%s]\n",
+	     filename );
+    exit( -1 );
+  }
+
+  /* Which depths were listed for each round */
+  std::vector<bool> listed[ MAX_ROUNDS ];
+
+  char line[ PATH_LENGTH ];
+  while( fgets( line, PATH_LENGTH, file ) ) {
+    line[ strcspn( line, "\r\n" ) ] = '\0';
+    if( ( line[ 0 ] == '#' ) || ( line[ strspn( line, " \t" ) ] == '\0' ) ) {
+      continue;
+    }
+
+    int round;
+    int depth;
+    char sizes_str[ PATH_LENGTH ];
+    if( ( sscanf( line, "RAISES %d %d %1023s", &round, &depth, sizes_str ) != 3 )
+	|| ( round < 0 ) || ( round >= game->numRounds )
+	|| ( depth < 0 ) || ( depth >= MAX_NUM_ACTIONS ) ) {
+      fprintf( stderr, "Could not parse action abstraction line [%s]\n",
+	       line );
+      exit( -1 );
+    }
+    if( depth >= ( int ) raise_sizes[ round ].size( ) ) {
+      raise_sizes[ round ].resize( depth + 1 );
+      listed[ round ].resize( depth + 1, false );
+    }
+    if( listed[ round ][ depth ] ) {
+      fprintf( stderr, "Raise sizes for round %d, depth %d listed twice\n",
+	       round, depth );
+      exit( -1 );
+    }
+    listed[ round ][ depth ] = true;
+
+    std::vector<double> &sizes = raise_sizes[ round ][ depth ];
+    if( strcmp( sizes_str, "NONE" ) ) {
+      char *size_str = strtok( sizes_str, "," );
+      while( size_str != NULL ) {
+	if( !strcmp( size_str, "ALLIN" ) ) {
+	  sizes.push_back( HUGE_VAL );
+	} else {
+	  char *end;
+	  const double fraction = strtod( size_str, &end );
+	  if( ( *end != '\0' ) || !( fraction > 0 ) || isinf( fraction ) ) {
+	    fprintf( stderr, "Bad raise size [%s] on action abstraction "
+		     "line [%s]\n", size_str, line );
+	    exit( -1 );
+	  }
+	  sizes.push_back( fraction );
+	}
+	size_str = strtok( NULL, "," );
+      }
+    }
+    /* Room for fold and call as well */
+    if( ( int ) sizes.size( ) + 2 > MAX_ABSTRACT_ACTIONS ) {
+      fprintf( stderr, "Round %d, depth %d lists %zu raise sizes, but at most "
+	       "%d are allowed\n", round, depth, sizes.size( ),
+	       MAX_ABSTRACT_ACTIONS - 2 );
+      exit( -1 );
+    }
+    std::sort( sizes.begin( ), sizes.end( ) );
+    sizes.erase( std::unique( sizes.begin( ), sizes.end( ) ), sizes.end( ) );
+  }
+  fclose( file );
+
+  for( int r = 0; r < game->numRounds; ++r ) {
+    if( listed[ r ].empty( ) || !listed[ r ][ 0 ] ) {
+      fprintf( stderr, "Action abstraction file [%s] has no raise sizes for "
+	       "round %d, depth 0\n", filename, r );
+      exit( -1 );
+    }
+    for( size_t d = 1; d < raise_sizes[ r ].size( ); ++d ) {
+      if( !listed[ r ][ d ] ) {
+	raise_sizes[ r ][ d ] = raise_sizes[ r ][ d - 1 ];
+      }
+    }
+  }
+}
+
+ConfigurableActionAbstraction::~ConfigurableActionAbstraction( )
+{
+}
+
+int ConfigurableActionAbstraction::get_actions( const Game *game,
+						const State &state,
+						Action actions
+						[ MAX_ABSTRACT_ACTIONS ] ) const
+{
+  const std::vector<std::vector<double> > &round_sizes
+    = raise_sizes[ state.round ];
+  const std::vector<double> &sizes
+    = round_sizes[ std::min( ( size_t ) numRaises( &state ),
+			     round_sizes.size( ) - 1 ) ];
+
+  int num_actions = 0;
+  for( int a = 0; a < NUM_ACTION_TYPES; ++a ) {
+    Action action;
+    action.type = ( ActionType ) a;
+    action.size = 0;
+    if( action.type == a_raise ) {
+      int32_t min_raise_size;
+      int32_t max_raise_size;
+      if( sizes.empty( )
+	  || !raiseIsValid( game, &state, &min_raise_size, &max_raise_size ) ) {
+	continue;
+      }
+      if( game->bettingType != noLimitBetting ) {
+	actions[ num_actions ] = action;
+	++num_actions;
+	continue;
+      }
+
+      /* Pot after calling, as for FCPA */
+      int32_t pot = 0;
+      for( int p = 0; p < game->numPlayers; ++p ) {
+	pot += state.spent[ p ];
+      }
+      uint8_t player = currentPlayer( game, &state );
+      int amount_to_call = state.maxSpent - state.spent[ player ];
+      pot += amount_to_call;
+
+      /* Sizes are increasing, so clamped sizes are too and any duplicates
+       * are next to each other
+       */
+      for( size_t s = 0; s < sizes.size( ); ++s ) {
+	int32_t raise_size = max_raise_size;
+	if( !isinf( sizes[ s ] ) ) {
+	  const double size = state.spent[ player ] + amount_to_call
+	    + sizes[ s ] * pot;
+	  if( size < max_raise_size ) {
+	    raise_size = std::max( min_raise_size,
+				   ( int32_t ) floor( size + 0.5 ) );
+	  }
+	}
+	if( ( num_actions > 0 ) && ( actions[ num_actions - 1 ].type == a_raise )
+	    && ( actions[ num_actions - 1 ].size == raise_size ) ) {
+	  continue;
+	}
+	actions[ num_actions ] = action;
+	actions[ num_actions ].size = raise_size;
+	++num_actions;
+      }
+
+    } else if( isValidAction( game, &state, 0, &action ) ) {
+      /* Fold and call */
+      actions[ num_actions ] = action;
+      ++num_actions;
+    }
+  }
+
+  return num_actions;
+}
@@ -10,6 +10,7 @@
  */
 
 /* C / C++ / STL indluces */
+#include <vector>
 
 /* project_acpc_server includes */
 extern "C" {
@@ -67,4 +68,37 @@ public:
 protected:
 };
 
+/* The configurable action abstraction allows fold, call, and raises sized
+ * as fractions of the pot, read from a file.  Each round lists the raise
+ * sizes allowed after each number of raises already made in that round:
+ *
+ *   # Comment
+ *   RAISES <round> <depth> <size>[,<size>...]
+ *   RAISES <round> <depth> NONE
+ *
+ * where each size is a pot fraction (1 is a pot-sized raise) or ALLIN.
+ * Depth 0 must be listed for every round, and any depth not listed uses
+ * the sizes of the closest smaller depth that is, so the last depth listed
+ * applies to all deeper raises.  Sizes below the minimum raise or above
+ * the stack are moved to the minimum raise or all-in, and duplicates are
+ * dropped.  In limit games, any size allows the single legal raise.  With
+ * RAISES <round> 0 1,ALLIN for every round, this is the FCPA abstraction.
+ */
+class ConfigurableActionAbstraction : public ActionAbstraction {
+public:
+
+  ConfigurableActionAbstraction( const Game *game, const char *filename );
+  virtual ~ConfigurableActionAbstraction( );
+
+  virtual int get_actions( const Game *game,
+			   const State &state,
+			   Action actions[ MAX_ABSTRACT_ACTIONS ] ) const;
+
+protected:
+  /* Pot fractions in increasing order, with all-in as infinity, for each
+   * round and depth
+   */
+  std::vector<std::vector<double> > raise_sizes[ MAX_ROUNDS ];
+};
+
 #endif
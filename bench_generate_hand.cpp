@@ -0,0 +1,56 @@
+/* bench_generate_hand.cpp
+ * Times PureCfrMachine::generate_hand, which deals, ranks and buckets every
+ * hand a worker walks.  Takes the same arguments as pure_cfr.
+ */
+
+/* C / C++ / STL includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+/* Pure CFR includes */
+#include "parameters.hpp"
+#include "pure_cfr_machine.hpp"
+#include "rng_engine.hpp"
+
+/* Hands dealt in each timed pass */
+static const int BENCH_HANDS = 2000000;
+static const int BENCH_PASSES = 3;
+
+static double get_seconds( )
+{
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+int main( const int argc, const char *argv[] )
+{
+  Parameters params;
+  if( params.parse( argc, argv ) ) {
+    return 1;
+  }
+  PureCfrMachine pcm( params );
+
+  rng_engine_t rng;
+  rng_seed( rng, params.rng_type, params.rng_seeds, NUM_RNG_SEEDS );
+
+  for( int pass = 0; pass < BENCH_PASSES; ++pass ) {
+    /* Sum something from each hand so that no work can be skipped */
+    hand_t hand;
+    int64_t sum = 0;
+    const double start = get_seconds( );
+    for( int i = 0; i < BENCH_HANDS; ++i ) {
+      if( pcm.generate_hand( hand, rng ) ) {
+	fprintf( stderr, "Unable to generate hand.\n" );
+	return 1;
+      }
+      sum += hand.precomputed_buckets[ 0 ][ 0 ] + hand.eval.showdown_value_2p[ 0 ];
+    }
+    const double secs = get_seconds( ) - start;
+    fprintf( stderr, "%s: %.2fM hands/s (%jd)\n", params.game_file,
+	     BENCH_HANDS / secs / 1e6, ( intmax_t ) sum );
+  }
+
+  return 0;
+}
@@ -60,84 +60,92 @@ InfoSetNode2p::~InfoSetNode2p( )
 {
 }
 
-TerminalNode3p::TerminalNode3p( const uint32_t new_pot_size,
+TerminalNodeNp::TerminalNodeNp( const uint32_t new_pot_size,
 				const uint32_t new_money_spent[ MAX_PURE_CFR_PLAYERS ],
-				const leaf_type_t new_leaf_type )
+				const uint8_t new_fold_mask )
   : BettingNode( ),
     pot_size( new_pot_size ),
-    leaf_type( new_leaf_type )
+    fold_mask( new_fold_mask )
 {
   memcpy( money_spent, new_money_spent, MAX_PURE_CFR_PLAYERS * sizeof( money_spent[ 0 ] ) );
 }
 
-TerminalNode3p::~TerminalNode3p( )
+TerminalNodeNp::~TerminalNodeNp( )
 {
 }
 
-int TerminalNode3p::evaluate( const hand_t &hand, const int position ) const
+int TerminalNodeNp::evaluate( const hand_t &hand, const int position ) const
 {
-  return ( pot_size / hand.eval.pot_frac_recip[ position ][ leaf_type ] )
-    - money_spent[ position ];
+  if( ( fold_mask >> position ) & 1 ) {
+    return -money_spent[ position ];
+  }
+
+  /* The best hand left is the first player in order who has not folded */
+  const int8_t *order = hand.eval.showdown_np.order;
+  const int8_t *strength = hand.eval.showdown_np.strength;
+  int i = 0;
+  while( ( fold_mask >> order[ i ] ) & 1 ) {
+    ++i;
+  }
+  const int8_t best = strength[ order[ i ] ];
+  if( strength[ position ] != best ) {
+    return -money_spent[ position ];
+  }
+
+  /* Split the pot between everyone left with the best strength */
+  int num_winners = 0;
+  for( ; ( i < MAX_PURE_CFR_PLAYERS ) && ( strength[ order[ i ] ] == best );
+       ++i ) {
+    num_winners += !( ( fold_mask >> order[ i ] ) & 1 );
+  }
+  return ( pot_size / num_winners ) - money_spent[ position ];
 }
 
-InfoSetNode3p::InfoSetNode3p( const int64_t new_soln_idx,
+InfoSetNodeNp::InfoSetNodeNp( const int64_t new_soln_idx,
 			      const int new_num_choices,
 			      const int8_t new_player,
 			      const int8_t new_round,
-			      const int8_t new_player_folded
-			      [ MAX_PURE_CFR_PLAYERS ],
 			      const BettingNode *new_child,
 			      const uint32_t new_pot_size,
 			      const uint32_t new_money_spent
 			      [ MAX_PURE_CFR_PLAYERS ],
-			      const leaf_type_t new_leaf_type )
-  : TerminalNode3p( new_pot_size, new_money_spent, new_leaf_type ),
+			      const uint8_t new_fold_mask )
+  : TerminalNodeNp( new_pot_size, new_money_spent, new_fold_mask ),
     soln_idx( new_soln_idx ),
     num_choices( new_num_choices ),
     player( new_player ),
     round( new_round ),
     child( new_child )
 {
-  memcpy( player_folded, new_player_folded, MAX_PURE_CFR_PLAYERS * sizeof( player_folded[ 0 ] ) );
 }
 
-InfoSetNode3p::~InfoSetNode3p( )
+InfoSetNodeNp::~InfoSetNodeNp( )
 {
 }
 
-void get_term_values_3p( const State &state,
+void get_term_values_np( const State &state,
 			 const Game *game,
 			 uint32_t &pot_size,
 			 uint32_t money_spent[ MAX_PURE_CFR_PLAYERS ],
-			 leaf_type_t &leaf_type )
+			 uint8_t &fold_mask )
 {
+  pot_size = 0;
+  fold_mask = 0;
+  memset( money_spent, 0, MAX_PURE_CFR_PLAYERS * sizeof( money_spent[ 0 ] ) );
   for( int p = 0; p < game->numPlayers; ++p ) {
     money_spent[ p ] = state.spent[ p ];
     pot_size += money_spent[ p ];
-  }
-
-  /* Leaf type, which is 3p-specific */
-  if( state.playerFolded[ 1 ] && state.playerFolded[ 2 ] ) {
-    leaf_type = LEAF_P0;
-  } else if( state.playerFolded[ 0 ] && state.playerFolded[ 2 ] ) {
-    leaf_type = LEAF_P1;
-  } else if( state.playerFolded[ 0 ] && state.playerFolded [ 1 ] ) {
-    leaf_type = LEAF_P2;
-  } else if( state.playerFolded[ 2 ] ) {
-    leaf_type = LEAF_P0_P1;
-  } else if( state.playerFolded[ 1 ] ) {
-    leaf_type = LEAF_P0_P2;
-  } else if( state.playerFolded[ 0 ] ) {
-    leaf_type = LEAF_P1_P2;
-  } else {
-    leaf_type = LEAF_P0_P1_P2;
+    if( state.playerFolded[ p ] ) {
+      fold_mask |= 1 << p;
+    }
   }
 }
 
 BettingNode *init_betting_tree_r( State &state,
 				  const Game *game,
 				  const ActionAbstraction *action_abs,
-				  size_t num_entries_per_bucket[ MAX_ROUNDS ] )
+				  size_t num_entries_per_bucket[ MAX_ROUNDS ],
+				  std::vector<Action> node_actions[ MAX_ROUNDS ] )
 {
   BettingNode *node;
   
@@ -166,19 +174,14 @@ BettingNode *init_betting_tree_r( State &state,
       break;
     }
 
-    case 3: {
+    default: {
       uint32_t pot_size;
       uint32_t money_spent[ MAX_PURE_CFR_PLAYERS ];
-      leaf_type_t leaf_type;
-      get_term_values_3p( state, game, pot_size, money_spent, leaf_type );
-      node = new TerminalNode3p( pot_size, money_spent, leaf_type );
+      uint8_t fold_mask;
+      get_term_values_np( state, game, pot_size, money_spent, fold_mask );
+      node = new TerminalNodeNp( pot_size, money_spent, fold_mask );
       break;
     }
-    
-    default:
-      fprintf( stderr, "cannot initialize betting tree for %d-players\n",
-	       game->numPlayers );
-      assert( 0 );
     }
     
     return node;
@@ -191,8 +194,10 @@ BettingNode *init_betting_tree_r( State &state,
   /* Next, grab the index for this node into the regrets and avg_strategy */
   int64_t soln_idx = num_entries_per_bucket[ state.round ];
 
-  /* Update number of entries */
+  /* Update number of entries, and keep the actions for this node's entries */
   num_entries_per_bucket[ state.round ] += num_choices;
+  node_actions[ state.round ].insert( node_actions[ state.round ].end( ),
+				      actions, actions + num_choices );
   
   /* Recurse to create children */
   BettingNode *first_child = NULL;
@@ -202,7 +207,8 @@ BettingNode *init_betting_tree_r( State &state,
     State new_state( state );
     doAction( game, &actions[ a ], &new_state );
     BettingNode *child = init_betting_tree_r( new_state, game, action_abs,
-					      num_entries_per_bucket );
+					      num_entries_per_bucket,
+					      node_actions );
     if( last_child != NULL ) {
       last_child->set_sibling( child );
     } else {
@@ -226,26 +232,18 @@ BettingNode *init_betting_tree_r( State &state,
 			      state.round, first_child ); 
     break;
 
-  case 3:
+  default: {
     /* We need some additional values not needed in 2p games */
-    int8_t player_folded[ MAX_PURE_CFR_PLAYERS ];
-    for( int p = 0; p < game->numPlayers; ++p ) {
-      player_folded[ p ] = ( state.playerFolded[ p ] ? 1 : 0 );
-    }
     uint32_t pot_size;
     uint32_t money_spent[ MAX_PURE_CFR_PLAYERS ];
-    leaf_type_t leaf_type;
-    get_term_values_3p( state, game, pot_size, money_spent, leaf_type );
+    uint8_t fold_mask;
+    get_term_values_np( state, game, pot_size, money_spent, fold_mask );
     
-    node = new InfoSetNode3p( soln_idx, num_choices, currentPlayer( game, &state ),
-			      state.round, player_folded, first_child,
-			      pot_size, money_spent, leaf_type );
+    node = new InfoSetNodeNp( soln_idx, num_choices, currentPlayer( game, &state ),
+			      state.round, first_child,
+			      pot_size, money_spent, fold_mask );
     break;
-
-  default:
-    fprintf( stderr, "cannot initialize betting tree for %d-players\n",
-	     game->numPlayers );
-    assert( 0 );
+  }
   }
 
   return node;
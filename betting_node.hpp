@@ -17,6 +17,7 @@
 /* C / C++ / STL indluces */
 #include <inttypes.h>
 #include <assert.h>
+#include <vector>
 
 /* C project_acpc_server indluces */
 extern "C" {
@@ -44,6 +45,13 @@ public:
   virtual int8_t get_round( ) const { assert( 0 ); }
   virtual int8_t did_player_fold( const int position ) const { assert( 0 ); }
 
+  /* 2p terminal nodes only.  Money won by position if the hand ends here
+   * by folding, and money won by the better hand if it ends in a showdown.
+   * Each is 0 if the hand does not end that way.
+   */
+  virtual int get_fold_money( const int position ) const { assert( 0 ); }
+  virtual int get_showdown_money( ) const { assert( 0 ); }
+
   virtual const BettingNode *get_child( ) const = 0;
   virtual BettingNode *get_sibling( ) const { return sibling; }
   virtual void set_sibling( BettingNode *new_sibling ) { sibling = new_sibling; }
@@ -60,6 +68,10 @@ public:
 
   virtual int evaluate( const hand_t &hand, const int position ) const;
 
+  virtual int get_fold_money( const int position ) const
+  { return ( showdown ? 0 : fold_value[ position ] * money ); }
+  virtual int get_showdown_money( ) const { return ( showdown ? money : 0 ); }
+
   virtual BettingNode *get_child( ) const { return NULL; }
 
 protected:
@@ -94,13 +106,17 @@ protected:
   const BettingNode* child;
 };
 
-class TerminalNode3p : public BettingNode {
+/* Terminal node for games of more than 2 players.  Bit p of fold_mask is set
+ * if player p has folded, and the pot is split between the players left with
+ * the best hand.
+ */
+class TerminalNodeNp : public BettingNode {
 public:
 
-  TerminalNode3p( const uint32_t new_pot_size,
+  TerminalNodeNp( const uint32_t new_pot_size,
 		  const uint32_t new_money_spent[ MAX_PURE_CFR_PLAYERS ],
-		  const leaf_type_t new_leaf_type );
-  virtual ~TerminalNode3p( );
+		  const uint8_t new_fold_mask );
+  virtual ~TerminalNodeNp( );
 
   virtual int evaluate( const hand_t &hand, const int position ) const;
 
@@ -109,32 +125,31 @@ public:
 protected:
   const uint32_t pot_size;
   uint32_t money_spent[ MAX_PURE_CFR_PLAYERS ];
-  const leaf_type_t leaf_type;
+  const uint8_t fold_mask;
 };
 
-/* InfoSetNode3p derives from TerminalNode3p since we want to terminate tree walks prematurely
+/* InfoSetNodeNp derives from TerminalNodeNp since we want to terminate tree walks prematurely
  * before reaching a terminal node after the current player folds.
  */
-class InfoSetNode3p : public TerminalNode3p {
+class InfoSetNodeNp : public TerminalNodeNp {
 public:
 
-  InfoSetNode3p( const int64_t new_soln_idx,
+  InfoSetNodeNp( const int64_t new_soln_idx,
 		 const int new_num_choices,
 		 const int8_t new_player,
 		 const int8_t new_round,
-		 const int8_t new_player_folded[ MAX_PURE_CFR_PLAYERS ],
 		 const BettingNode *new_child,
 		 const uint32_t new_pot_size,
 		 const uint32_t new_money_spent[ MAX_PURE_CFR_PLAYERS ],
-		 const leaf_type_t new_leaf_type );
-  virtual ~InfoSetNode3p( );
+		 const uint8_t new_fold_mask );
+  virtual ~InfoSetNodeNp( );
 
   virtual int64_t get_soln_idx( ) const { return soln_idx; }
   virtual int get_num_choices( ) const { return num_choices; }
   virtual int8_t get_player( ) const { return player; }
   virtual int8_t get_round( ) const { return round; }
   virtual int8_t did_player_fold( const int position ) const
-  { return player_folded[ position ]; }
+  { return ( fold_mask >> position ) & 1; }
 
   virtual const BettingNode *get_child( ) const { return child; }
 
@@ -143,14 +158,18 @@ protected:
   const int num_choices;
   const int8_t player;
   const int8_t round;
-  int8_t player_folded[ MAX_PURE_CFR_PLAYERS ];
   const BettingNode *child;
 };
 
+/* Also appends the abstract action for each choice of every information set
+ * node to node_actions, so that a node's actions start at
+ * node_actions[ round ][ soln_idx ]
+ */
 BettingNode *init_betting_tree_r( State &state,
 				  const Game *game,
 				  const ActionAbstraction *action_abs,
-				  size_t num_entries_per_bucket[ MAX_ROUNDS ] );
+				  size_t num_entries_per_bucket[ MAX_ROUNDS ],
+				  std::vector<Action> node_actions[ MAX_ROUNDS ] );
 
 void destroy_betting_tree_r( const BettingNode *node );
 
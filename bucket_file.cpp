@@ -0,0 +1,116 @@
+/* bucket_file.cpp
+ * Layout of a file of precomputed buckets, read by --card-abs=FILE.
+ */
+
+/* C / C++ / STL includes */
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Pure CFR includes */
+#include "bucket_file.hpp"
+
+int init_bucket_file_header( const Game *game, const HandIndexer &indexer,
+			     const int *num_buckets,
+			     bucket_file_header_t &header )
+{
+  memset( &header, 0, sizeof( header ) );
+  memcpy( header.magic, BUCKET_FILE_MAGIC, sizeof( header.magic ) );
+  header.num_rounds = game->numRounds;
+
+  uint64_t offset = sizeof( header );
+  for( int r = 0; r < game->numRounds; ++r ) {
+    if( num_buckets[ r ] < 1 ) {
+      fprintf( stderr, "need at least one bucket in round %d\n", r );
+      return 1;
+    }
+    header.num_buckets[ r ] = num_buckets[ r ];
+    if( num_buckets[ r ] <= ( 1 << 8 ) ) {
+      header.bucket_bytes[ r ] = 1;
+    } else if( num_buckets[ r ] <= ( 1 << 16 ) ) {
+      header.bucket_bytes[ r ] = 2;
+    } else {
+      header.bucket_bytes[ r ] = 4;
+    }
+    header.num_hands[ r ] = indexer.get_size( r );
+
+    offset = ( offset + BUCKET_FILE_ALIGN - 1 )
+      / BUCKET_FILE_ALIGN * BUCKET_FILE_ALIGN;
+    header.table_offset[ r ] = offset;
+    offset += header.num_hands[ r ] * header.bucket_bytes[ r ];
+  }
+  header.file_size = offset;
+
+  return 0;
+}
+
+int check_bucket_file_header( const Game *game, const HandIndexer &indexer,
+			      const bucket_file_header_t &header,
+			      const uint64_t file_size )
+{
+  if( memcmp( header.magic, BUCKET_FILE_MAGIC, sizeof( header.magic ) ) ) {
+    fprintf( stderr, "not a bucket file\n" );
+    return 1;
+  }
+  if( header.num_rounds != ( uint32_t ) game->numRounds ) {
+    fprintf( stderr, "bucket file has %u rounds, but the game has %d\n",
+	     header.num_rounds, game->numRounds );
+    return 1;
+  }
+
+  /* The layout must be exactly what we would have written */
+  int num_buckets[ MAX_ROUNDS ];
+  for( int r = 0; r < game->numRounds; ++r ) {
+    if( ( header.num_buckets[ r ] < 1 ) || ( header.num_buckets[ r ] > INT_MAX ) ) {
+      fprintf( stderr, "bucket file has %u buckets in round %d\n",
+	       header.num_buckets[ r ], r );
+      return 1;
+    }
+    num_buckets[ r ] = header.num_buckets[ r ];
+  }
+  bucket_file_header_t expected;
+  if( init_bucket_file_header( game, indexer, num_buckets, expected ) ) {
+    return 1;
+  }
+  for( int r = 0; r < game->numRounds; ++r ) {
+    if( header.num_hands[ r ] != expected.num_hands[ r ] ) {
+      fprintf( stderr, "bucket file has %ju hands in round %d, but the game "
+	       "has %ju\n", ( uintmax_t ) header.num_hands[ r ], r,
+	       ( uintmax_t ) expected.num_hands[ r ] );
+      return 1;
+    }
+    if( ( header.bucket_bytes[ r ] != expected.bucket_bytes[ r ] )
+	|| ( header.table_offset[ r ] != expected.table_offset[ r ] ) ) {
+      fprintf( stderr, "bucket file table for round %d is not laid out as "
+	       "expected\n", r );
+      return 1;
+    }
+  }
+  if( ( header.file_size != expected.file_size )
+      || ( file_size != expected.file_size ) ) {
+    fprintf( stderr, "bucket file is %ju bytes, but should be %ju\n",
+	     ( uintmax_t ) file_size, ( uintmax_t ) expected.file_size );
+    return 1;
+  }
+
+  return 0;
+}
+
+uint64_t bucket_checksum( const void *data, const size_t len, uint64_t hash )
+{
+  /* FNV-1a, but a word at a time so that checking a large file does not
+   * take much longer than reading it
+   */
+  const uint64_t prime = 0x100000001b3ULL;
+  const uint8_t *bytes = ( const uint8_t * ) data;
+  size_t i = 0;
+  for( ; i + sizeof( uint64_t ) <= len; i += sizeof( uint64_t ) ) {
+    uint64_t word;
+    memcpy( &word, &bytes[ i ], sizeof( word ) );
+    hash = ( hash ^ word ) * prime;
+  }
+  for( ; i < len; ++i ) {
+    hash = ( hash ^ bytes[ i ] ) * prime;
+  }
+  return hash;
+}
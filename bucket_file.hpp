@@ -0,0 +1,64 @@
+#ifndef __PURE_CFR_BUCKET_FILE_HPP__
+#define __PURE_CFR_BUCKET_FILE_HPP__
+
+/* bucket_file.hpp
+ * Layout of a file of precomputed buckets, read by --card-abs=FILE.
+ *
+ * The file starts with a bucket_file_header_t, followed by one table per
+ * round.  Round r's table holds the bucket of every hand a player can see in
+ * round r, in the order a HandIndexer numbers them, each bucket taking
+ * bucket_bytes[ r ] bytes in host byte order.  Tables start on page
+ * boundaries so that the file can be mapped and shared straight from the
+ * page cache by every process that uses it.
+ */
+
+/* C / C++ / STL includes */
+#include <stdint.h>
+#include <stddef.h>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/game.h"
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "hand_indexer.hpp"
+
+const char BUCKET_FILE_MAGIC[ 8 ] = { 'P', 'C', 'F', 'R', 'B', 'K', 'T', '1' };
+/* Tables start at multiples of this many bytes */
+const size_t BUCKET_FILE_ALIGN = 4096;
+
+typedef struct {
+  char magic[ 8 ];
+  uint32_t num_rounds;
+  uint32_t num_buckets[ MAX_ROUNDS ];
+  uint32_t bucket_bytes[ MAX_ROUNDS ]; /* 1, 2 or 4 */
+  uint64_t num_hands[ MAX_ROUNDS ];
+  uint64_t table_offset[ MAX_ROUNDS ]; /* from the start of the file */
+  uint64_t file_size;
+  uint64_t checksum; /* bucket_checksum of every table in round order */
+} bucket_file_header_t;
+
+/* Fills in header for game's hands with num_buckets[ r ] buckets in each
+ * round r, except for the checksum.  Returns 0 on success, 1 on failure.
+ */
+int init_bucket_file_header( const Game *game, const HandIndexer &indexer,
+			     const int *num_buckets,
+			     bucket_file_header_t &header );
+
+/* Returns 0 if header is well formed and describes game's hands, or prints
+ * why not to stderr and returns 1
+ */
+int check_bucket_file_header( const Game *game, const HandIndexer &indexer,
+			      const bucket_file_header_t &header,
+			      const uint64_t file_size );
+
+/* Folds len bytes of data into the running checksum hash.  Start from
+ * BUCKET_CHECKSUM_START.
+ */
+const uint64_t BUCKET_CHECKSUM_START = 0xcbf29ce484222325ULL;
+uint64_t bucket_checksum( const void *data, const size_t len,
+			  uint64_t hash );
+
+#endif
@@ -0,0 +1,1162 @@
+/* build_buckets.cpp
+ * Builds a file of precomputed buckets for --card-abs=FILE.
+ *
+ * Every hand a player can see in a round, up to suit isomorphism, gets a
+ * feature vector.  In the last round this is the hand's strength: the
+ * fraction of a single opponent's holdings it beats at showdown, counting
+ * ties as half.  Games with more players get the same heads-up strength.
+ * In earlier rounds it is a histogram of the hand's strength over the ways
+ * the rest of the board can come.  Each round's hands are then clustered
+ * into the requested number of buckets with k-means, weighting each hand by
+ * the number of deals it stands for.  A round asked for at least as many
+ * buckets as it has hands keeps every hand in its own bucket.
+ *
+ * The work is split over threads, and progress is saved to
+ * <output_file>.checkpoint, with the features computed so far appended to
+ * <output_file>.checkpoint.features, so that an interrupted build picks up
+ * where it left off when run again with the same options.
+ */
+
+/* C / C++ / STL includes */
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <set>
+#include <vector>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/game.h"
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "utility.hpp"
+#include "hand.hpp"
+#include "hand_indexer.hpp"
+#include "hand_evaluator.hpp"
+#include "bucket_file.hpp"
+
+/* Hands a thread takes at a time while computing features */
+static const int64_t FEATURE_CHUNK = 1024;
+/* Microseconds between looks at the feature threads' progress */
+static const int FEATURE_POLL_USECS = 100000;
+
+static const char CHECKPOINT_MAGIC[ 8 ]
+= { 'P', 'C', 'F', 'R', 'B', 'B', 'C', '2' };
+
+typedef enum {
+  PHASE_FEATURES = 0,
+  PHASE_KMEANS = 1
+} build_phase_t;
+
+/* Saved to <output_file>.checkpoint, followed by the centres once
+ * clustering.  The features and weights of the first hands_done hands of the
+ * round are in <output_file>.checkpoint.features, the features of every hand
+ * of the round first and then the weights, so each checkpoint only writes
+ * the hands finished since the last.
+ */
+typedef struct {
+  char magic[ 8 ];
+  /* The options the build was started with */
+  uint32_t num_rounds;
+  int32_t num_buckets[ MAX_ROUNDS ];
+  int32_t num_bins;
+  int32_t num_samples;
+  uint32_t seed;
+  /* How far it got */
+  int32_t round;
+  int32_t phase;
+  int32_t iteration;
+  int64_t hands_done;
+} checkpoint_t;
+
+typedef struct {
+  /* Options */
+  int num_buckets[ MAX_ROUNDS ];
+  int num_threads;
+  int num_bins;
+  int num_samples; /* board completions per hand, or 0 for all of them */
+  int max_iterations;
+  uint32_t seed;
+  int status_seconds;
+  int checkpoint_seconds;
+  char output_file[ PATH_LENGTH ];
+  char checkpoint_file[ PATH_LENGTH ];
+  char features_file[ PATH_LENGTH ];
+
+  const Game *game;
+  const HandIndexer *indexer;
+  const HandEvaluator *evaluator;
+  uint8_t deck[ MAX_SUITS * MAX_RANKS ];
+  int num_deck_cards;
+  int num_board_cards[ MAX_ROUNDS ]; /* dealt by the end of each round */
+  int suit_perms[ 24 ][ MAX_SUITS ];
+  int num_suit_perms;
+
+  /* The output file, mapped */
+  bucket_file_header_t header;
+  uint8_t *file;
+
+  /* The round being built */
+  int round;
+  int dim;
+  int64_t num_hands;
+  std::vector<float> features;
+  std::vector<uint8_t> weights;
+  std::vector<double> centres;
+  int num_centres;
+
+  /* The features file, open, and how many of the round's hands it holds */
+  int features_fd;
+  int64_t hands_saved;
+
+  /* Shared by the feature threads */
+  int64_t next_hand;
+  int64_t hands_computed;
+} build_t;
+
+typedef struct {
+  build_t *build;
+  /* The first hand of the chunk a feature thread is working on, or
+   * num_hands once it has finished, so every earlier hand is done
+   */
+  volatile int64_t chunk;
+  int64_t begin;
+  int64_t end;
+  /* k-means sums of weighted features and weights by centre */
+  std::vector<double> sums;
+  std::vector<double> totals;
+  int64_t changed;
+  /* The hand furthest from its centre */
+  int64_t furthest;
+  double furthest_distance;
+} thread_args_t;
+
+static double get_seconds( )
+{
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Small fast generator for sampling board completions, seeded per hand so
+ * that a hand's features do not depend on which thread computed them
+ */
+static uint64_t splitmix64( uint64_t &state )
+{
+  uint64_t z = ( state += 0x9e3779b97f4a7c15ULL );
+  z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+  z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+  return z ^ ( z >> 31 );
+}
+
+static void print_usage( const char *prog_name )
+{
+  fprintf( stderr, "Usage: %s <game_file> <output_file> "
+	   "--buckets=<buckets[,buckets...]> [options]\n", prog_name );
+  fprintf( stderr, "  --buckets lists the buckets wanted in each round\n" );
+  fprintf( stderr, "Options:\n" );
+  fprintf( stderr, "  --threads=<num_threads>  (default: number of online "
+	   "CPUs)\n" );
+  fprintf( stderr, "  --bins=<num_bins>  (strength histogram bins, "
+	   "default: 10)\n" );
+  fprintf( stderr, "  --samples=<num_boards>  (board completions per hand, "
+	   "default: 0, all of them)\n" );
+  fprintf( stderr, "  --iterations=<iterations>  (most k-means iterations "
+	   "per round, default: 100)\n" );
+  fprintf( stderr, "  --seed=<seed>  (default: 1)\n" );
+  fprintf( stderr, "  --status=<dd:hh:mm:ss>  (default: 00:00:00:10)\n" );
+  fprintf( stderr, "  --checkpoint=<dd:hh:mm:ss>  (default: 00:00:10:00)\n" );
+}
+
+/* Returns 0 on success, 1 on failure */
+static int parse_args( const int argc, const char *argv[], build_t &build )
+{
+  if( argc < 4 ) {
+    print_usage( argv[ 0 ] );
+    return 1;
+  }
+
+  FILE *file = fopen( argv[ 1 ], "r" );
+  if( file == NULL ) {
+    fprintf( stderr, "failed to open game file [%s]\n", argv[ 1 ] );
+    return 1;
+  }
+  build.game = readGame( file );
+  fclose( file );
+  if( build.game == NULL ) {
+    fprintf( stderr, "failed to read game file [%s]\n", argv[ 1 ] );
+    return 1;
+  }
+  snprintf( build.output_file, PATH_LENGTH, "%s", argv[ 2 ] );
+  snprintf( build.checkpoint_file, PATH_LENGTH, "%s.checkpoint", argv[ 2 ] );
+  snprintf( build.features_file, PATH_LENGTH, "%s.checkpoint.features",
+	    argv[ 2 ] );
+
+  int num_bucket_rounds = 0;
+  /* One thread per online CPU, up to the most allowed */
+  const long num_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+  build.num_threads = ( num_cpus < 1 ? 1 : std::min( num_cpus,
+						      ( long ) MAX_WORKER_THREADS ) );
+  build.num_bins = 10;
+  build.num_samples = 0;
+  build.max_iterations = 100;
+  build.seed = 1;
+  build.status_seconds = 10;
+  build.checkpoint_seconds = 600;
+  for( int index = 3; index < argc; ++index ) {
+    if( !strncmp( argv[ index ], "--buckets=", strlen( "--buckets=" ) ) ) {
+      const char *str = &argv[ index ][ strlen( "--buckets=" ) ];
+      num_bucket_rounds = 0;
+      while( *str != '\0' ) {
+	char *end;
+	const long buckets = strtol( str, &end, 10 );
+	if( ( end == str ) || ( buckets < 1 ) || ( buckets > INT32_MAX )
+	    || ( num_bucket_rounds >= MAX_ROUNDS ) ) {
+	  fprintf( stderr, "could not read buckets from [%s]\n", argv[ index ] );
+	  return 1;
+	}
+	build.num_buckets[ num_bucket_rounds++ ] = buckets;
+	str = ( *end == ',' ? end + 1 : end );
+      }
+    } else if( !strncmp( argv[ index ], "--threads=", strlen( "--threads=" ) ) ) {
+      if( sscanf( &argv[ index ][ strlen( "--threads=" ) ], "%d",
+		  &build.num_threads ) < 1 ) {
+	fprintf( stderr, "could not read number of threads from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--bins=", strlen( "--bins=" ) ) ) {
+      if( sscanf( &argv[ index ][ strlen( "--bins=" ) ], "%d",
+		  &build.num_bins ) < 1 ) {
+	fprintf( stderr, "could not read number of bins from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--samples=", strlen( "--samples=" ) ) ) {
+      if( sscanf( &argv[ index ][ strlen( "--samples=" ) ], "%d",
+		  &build.num_samples ) < 1 ) {
+	fprintf( stderr, "could not read number of samples from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--iterations=",
+			 strlen( "--iterations=" ) ) ) {
+      if( sscanf( &argv[ index ][ strlen( "--iterations=" ) ], "%d",
+		  &build.max_iterations ) < 1 ) {
+	fprintf( stderr, "could not read iterations from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--seed=", strlen( "--seed=" ) ) ) {
+      if( sscanf( &argv[ index ][ strlen( "--seed=" ) ], "%u",
+		  &build.seed ) < 1 ) {
+	fprintf( stderr, "could not read seed from [%s]\n", argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--status=", strlen( "--status=" ) ) ) {
+      build.status_seconds
+	= time_string_to_seconds( &argv[ index ][ strlen( "--status=" ) ] );
+      if( build.status_seconds <= 0 ) {
+	fprintf( stderr, "could not read status frequency from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--checkpoint=",
+			 strlen( "--checkpoint=" ) ) ) {
+      build.checkpoint_seconds
+	= time_string_to_seconds( &argv[ index ][ strlen( "--checkpoint=" ) ] );
+      if( build.checkpoint_seconds <= 0 ) {
+	fprintf( stderr, "could not read checkpoint frequency from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else {
+      fprintf( stderr, "unknown option [%s]\n", argv[ index ] );
+      return 1;
+    }
+  }
+
+  if( num_bucket_rounds != build.game->numRounds ) {
+    fprintf( stderr, "--buckets must give the buckets for each of the "
+	     "game's %d rounds\n", build.game->numRounds );
+    return 1;
+  }
+  if( ( build.num_threads < 1 ) || ( build.num_threads > MAX_WORKER_THREADS ) ) {
+    fprintf( stderr, "number of threads must be between 1 and %d\n",
+	     MAX_WORKER_THREADS );
+    return 1;
+  }
+  if( ( build.num_bins < 1 ) || ( build.num_samples < 0 )
+      || ( build.max_iterations < 1 ) ) {
+    fprintf( stderr, "bins and iterations must be positive, and samples "
+	     "not negative\n" );
+    return 1;
+  }
+  if( build.game->numSuits > MAX_SUITS ) {
+    fprintf( stderr, "games with more than %d suits are not supported\n",
+	     MAX_SUITS );
+    return 1;
+  }
+
+  return 0;
+}
+
+/* The fraction of a single opponent's holdings that player 0's hand beats,
+ * counting ties as half.  used marks the cards in hand and on the full board.
+ * Only player 1 is dealt in, so the evaluator must rank two players.
+ */
+static double hand_strength( const build_t &build, hand_t &hand,
+			     const bool *used )
+{
+  const int num_hole_cards = build.game->numHoleCards;
+  uint8_t cards[ MAX_SUITS * MAX_RANKS ];
+  int num_cards = 0;
+  for( int i = 0; i < build.num_deck_cards; ++i ) {
+    if( !used[ build.deck[ i ] ] ) {
+      cards[ num_cards++ ] = build.deck[ i ];
+    }
+  }
+
+  /* Walk every set of num_hole_cards of the cards left */
+  int combo[ MAX_HOLE_CARDS ];
+  for( int i = 0; i < num_hole_cards; ++i ) {
+    combo[ i ] = i;
+  }
+  double wins = 0;
+  int64_t num_opponents = 0;
+  while( true ) {
+    for( int i = 0; i < num_hole_cards; ++i ) {
+      hand.hole_cards[ 1 ][ i ] = cards[ combo[ i ] ];
+    }
+    int ranks[ MAX_PURE_CFR_PLAYERS ];
+    build.evaluator->rank_hands( hand, ranks );
+    wins += ( ranks[ 0 ] > ranks[ 1 ] ? 1 : ( ranks[ 0 ] == ranks[ 1 ] ? 0.5 : 0 ) );
+    ++num_opponents;
+
+    int i = num_hole_cards - 1;
+    while( ( i >= 0 ) && ( combo[ i ] == num_cards - num_hole_cards + i ) ) {
+      --i;
+    }
+    if( i < 0 ) {
+      break;
+    }
+    ++combo[ i ];
+    for( int j = i + 1; j < num_hole_cards; ++j ) {
+      combo[ j ] = combo[ j - 1 ] + 1;
+    }
+  }
+
+  return ( num_opponents > 0 ? wins / num_opponents : 0.5 );
+}
+
+/* The number of deals, up to the order of each round's cards, that the
+ * hand's index stands for
+ */
+static int hand_weight( const build_t &build, const uint8_t *hole_cards,
+			const uint8_t *board_cards )
+{
+  /* Count the suit relabellings that leave every group's cards the same */
+  int num_fixed = 0;
+  for( int p = 0; p < build.num_suit_perms; ++p ) {
+    const int *perm = build.suit_perms[ p ];
+    bool fixed;
+    uint64_t hole = 0, hole_perm = 0;
+    for( int i = 0; i < build.game->numHoleCards; ++i ) {
+      hole |= 1ULL << hole_cards[ i ];
+      hole_perm |= 1ULL << makeCard( rankOfCard( hole_cards[ i ] ),
+				     perm[ suitOfCard( hole_cards[ i ] ) ] );
+    }
+    fixed = ( hole == hole_perm );
+    for( int r = 0; fixed && ( r <= build.round ); ++r ) {
+      uint64_t board = 0, board_perm = 0;
+      for( int i = bcStart( build.game, r ); i < sumBoardCards( build.game, r );
+	   ++i ) {
+	board |= 1ULL << board_cards[ i ];
+	board_perm |= 1ULL << makeCard( rankOfCard( board_cards[ i ] ),
+					perm[ suitOfCard( board_cards[ i ] ) ] );
+      }
+      fixed = ( board == board_perm );
+    }
+    num_fixed += fixed;
+  }
+  return build.num_suit_perms / num_fixed;
+}
+
+/* Fills in the features and weight of hand index in the current round */
+static void compute_features( const build_t &build, const int64_t index,
+			      float *features, uint8_t &weight )
+{
+  const Game *game = build.game;
+  hand_t hand;
+  memset( &hand, 0, sizeof( hand ) );
+  build.indexer->unindex_hand( build.round, index, hand.hole_cards[ 0 ],
+			       hand.board_cards );
+  weight = hand_weight( build, hand.hole_cards[ 0 ], hand.board_cards );
+
+  bool used[ MAX_SUITS * MAX_RANKS ] = { false };
+  for( int i = 0; i < game->numHoleCards; ++i ) {
+    used[ hand.hole_cards[ 0 ][ i ] ] = true;
+  }
+  const int num_dealt = build.num_board_cards[ build.round ];
+  for( int i = 0; i < num_dealt; ++i ) {
+    used[ hand.board_cards[ i ] ] = true;
+  }
+
+  if( build.round == game->numRounds - 1 ) {
+    features[ 0 ] = hand_strength( build, hand, used );
+    return;
+  }
+
+  /* Histogram the strength over the rest of the board */
+  uint8_t cards[ MAX_SUITS * MAX_RANKS ];
+  int num_cards = 0;
+  for( int i = 0; i < build.num_deck_cards; ++i ) {
+    if( !used[ build.deck[ i ] ] ) {
+      cards[ num_cards++ ] = build.deck[ i ];
+    }
+  }
+  const int num_to_come = build.num_board_cards[ game->numRounds - 1 ]
+    - num_dealt;
+  double num_boards = 1;
+  for( int i = 0; i < num_to_come; ++i ) {
+    num_boards = num_boards * ( num_cards - i ) / ( i + 1 );
+  }
+  const bool sample = ( build.num_samples > 0 )
+    && ( num_boards > build.num_samples );
+
+  std::vector<double> histogram( build.dim, 0 );
+  uint64_t rng = ( ( uint64_t ) build.seed << 32 )
+    ^ ( ( uint64_t ) build.round << 56 ) ^ ( uint64_t ) index;
+  int combo[ MAX_BOARD_CARDS ];
+  for( int i = 0; i < num_to_come; ++i ) {
+    combo[ i ] = i;
+  }
+  int64_t num_done = 0;
+  while( true ) {
+    if( sample ) {
+      /* A partial shuffle puts a random set of the cards left up front */
+      for( int i = 0; i < num_to_come; ++i ) {
+	const int j = i + splitmix64( rng ) % ( num_cards - i );
+	std::swap( cards[ i ], cards[ j ] );
+	hand.board_cards[ num_dealt + i ] = cards[ i ];
+      }
+    } else {
+      for( int i = 0; i < num_to_come; ++i ) {
+	hand.board_cards[ num_dealt + i ] = cards[ combo[ i ] ];
+      }
+    }
+    for( int i = 0; i < num_to_come; ++i ) {
+      used[ hand.board_cards[ num_dealt + i ] ] = true;
+    }
+    const double strength = hand_strength( build, hand, used );
+    for( int i = 0; i < num_to_come; ++i ) {
+      used[ hand.board_cards[ num_dealt + i ] ] = false;
+    }
+    histogram[ std::min( build.dim - 1, ( int ) ( strength * build.dim ) ) ] += 1;
+    ++num_done;
+
+    if( sample ) {
+      if( num_done >= build.num_samples ) {
+	break;
+      }
+      continue;
+    }
+    int i = num_to_come - 1;
+    while( ( i >= 0 ) && ( combo[ i ] == num_cards - num_to_come + i ) ) {
+      --i;
+    }
+    if( i < 0 ) {
+      break;
+    }
+    ++combo[ i ];
+    for( int j = i + 1; j < num_to_come; ++j ) {
+      combo[ j ] = combo[ j - 1 ] + 1;
+    }
+  }
+  for( int d = 0; d < build.dim; ++d ) {
+    features[ d ] = histogram[ d ] / num_done;
+  }
+}
+
+static void *feature_thread( void *thread_args )
+{
+  thread_args_t *args = ( thread_args_t * ) thread_args;
+  build_t &build = *args->build;
+
+  while( true ) {
+    const int64_t begin = __sync_fetch_and_add( &build.next_hand, FEATURE_CHUNK );
+    /* The features written so far must be seen before the new chunk */
+    __sync_synchronize( );
+    if( begin >= build.num_hands ) {
+      args->chunk = build.num_hands;
+      break;
+    }
+    args->chunk = begin;
+    const int64_t end = std::min( begin + FEATURE_CHUNK, build.num_hands );
+    for( int64_t i = begin; i < end; ++i ) {
+      compute_features( build, i, &build.features[ i * build.dim ],
+			build.weights[ i ] );
+    }
+    __sync_fetch_and_add( &build.hands_computed, end - begin );
+  }
+
+  return NULL;
+}
+
+static uint32_t get_table_bucket( const build_t &build, const int64_t index )
+{
+  const uint8_t *table = build.file + build.header.table_offset[ build.round ];
+  switch( build.header.bucket_bytes[ build.round ] ) {
+  case 1:
+    return table[ index ];
+  case 2:
+    return ( ( const uint16_t * ) table )[ index ];
+  default:
+    return ( ( const uint32_t * ) table )[ index ];
+  }
+}
+
+static void set_table_bucket( build_t &build, const int64_t index,
+			      const uint32_t bucket )
+{
+  uint8_t *table = build.file + build.header.table_offset[ build.round ];
+  switch( build.header.bucket_bytes[ build.round ] ) {
+  case 1:
+    table[ index ] = bucket;
+    break;
+  case 2:
+    ( ( uint16_t * ) table )[ index ] = bucket;
+    break;
+  default:
+    ( ( uint32_t * ) table )[ index ] = bucket;
+  }
+}
+
+/* Assigns the thread's hands to their nearest centres in the output table
+ * and sums the features of each centre's hands
+ */
+static void *kmeans_thread( void *thread_args )
+{
+  thread_args_t *args = ( thread_args_t * ) thread_args;
+  build_t &build = *args->build;
+  const int dim = build.dim;
+
+  args->sums.assign( build.num_centres * dim, 0 );
+  args->totals.assign( build.num_centres, 0 );
+  args->changed = 0;
+  args->furthest = -1;
+  args->furthest_distance = -1;
+  for( int64_t i = args->begin; i < args->end; ++i ) {
+    const float *features = &build.features[ i * dim ];
+    int best = 0;
+    double best_distance = INFINITY;
+    for( int c = 0; c < build.num_centres; ++c ) {
+      const double *centre = &build.centres[ c * dim ];
+      double distance = 0;
+      for( int d = 0; d < dim; ++d ) {
+	const double diff = features[ d ] - centre[ d ];
+	distance += diff * diff;
+      }
+      if( distance < best_distance ) {
+	best_distance = distance;
+	best = c;
+      }
+    }
+    if( best_distance > args->furthest_distance ) {
+      args->furthest_distance = best_distance;
+      args->furthest = i;
+    }
+    if( get_table_bucket( build, i ) != ( uint32_t ) best ) {
+      set_table_bucket( build, i, best );
+      ++args->changed;
+    }
+    const double weight = build.weights[ i ];
+    for( int d = 0; d < dim; ++d ) {
+      args->sums[ best * dim + d ] += weight * features[ d ];
+    }
+    args->totals[ best ] += weight;
+  }
+
+  return NULL;
+}
+
+/* Starts one of the thread functions on num_threads threads, doing a
+ * thread's share itself if it cannot be started
+ */
+static void start_threads( build_t &build, void *( *func )( void * ),
+			   std::vector<thread_args_t> &args,
+			   std::vector<pthread_t> &threads,
+			   std::vector<bool> &launched )
+{
+  threads.resize( build.num_threads );
+  launched.resize( build.num_threads );
+  for( int t = 0; t < build.num_threads; ++t ) {
+    args[ t ].build = &build;
+    launched[ t ] = ( pthread_create( &threads[ t ], NULL, func,
+				      &args[ t ] ) == 0 );
+    if( !launched[ t ] ) {
+      func( &args[ t ] );
+    }
+  }
+}
+
+static void join_threads( std::vector<pthread_t> &threads,
+			  const std::vector<bool> &launched )
+{
+  for( size_t t = 0; t < threads.size( ); ++t ) {
+    if( launched[ t ] ) {
+      pthread_join( threads[ t ], NULL );
+    }
+  }
+}
+
+static void run_threads( build_t &build, void *( *func )( void * ),
+			 std::vector<thread_args_t> &args )
+{
+  std::vector<pthread_t> threads;
+  std::vector<bool> launched;
+  start_threads( build, func, args, threads, launched );
+  join_threads( threads, launched );
+}
+
+/* Writes, or reads, bytes bytes at offset of fd.
+ * Returns 0 on success, 1 on failure.
+ */
+static int pwrite_all( const int fd, const void *buf, size_t bytes,
+		       off_t offset )
+{
+  const uint8_t *ptr = ( const uint8_t * ) buf;
+  while( bytes > 0 ) {
+    const ssize_t done = pwrite( fd, ptr, bytes, offset );
+    if( done <= 0 ) {
+      return 1;
+    }
+    ptr += done;
+    bytes -= done;
+    offset += done;
+  }
+  return 0;
+}
+
+static int pread_all( const int fd, void *buf, size_t bytes, off_t offset )
+{
+  uint8_t *ptr = ( uint8_t * ) buf;
+  while( bytes > 0 ) {
+    const ssize_t done = pread( fd, ptr, bytes, offset );
+    if( done <= 0 ) {
+      return 1;
+    }
+    ptr += done;
+    bytes -= done;
+    offset += done;
+  }
+  return 0;
+}
+
+/* Appends the features and weights of the hands finished since the last
+ * checkpoint to the features file.  Returns 0 on success, 1 on failure.
+ */
+static int save_features( build_t &build, const int64_t hands_done )
+{
+  if( hands_done <= build.hands_saved ) {
+    return 0;
+  }
+  const int64_t num_new = hands_done - build.hands_saved;
+  const off_t weights_offset
+    = ( off_t ) build.num_hands * build.dim * sizeof( float );
+  if( pwrite_all( build.features_fd,
+		  &build.features[ build.hands_saved * build.dim ],
+		  num_new * build.dim * sizeof( float ),
+		  ( off_t ) build.hands_saved * build.dim * sizeof( float ) )
+      || pwrite_all( build.features_fd, &build.weights[ build.hands_saved ],
+		     num_new, weights_offset + build.hands_saved )
+      || fdatasync( build.features_fd ) ) {
+    fprintf( stderr, "failed to write features file [%s]\n",
+	     build.features_file );
+    return 1;
+  }
+  build.hands_saved = hands_done;
+
+  return 0;
+}
+
+/* Returns 0 on success, 1 on failure */
+static int write_checkpoint( build_t &build, const checkpoint_t &checkpoint )
+{
+  /* Finished rounds live in the output file, so it must reach the disk
+   * before a checkpoint that counts on them
+   */
+  if( msync( build.file, build.header.file_size, MS_SYNC ) ) {
+    fprintf( stderr, "failed to sync [%s]\n", build.output_file );
+    return 1;
+  }
+
+  /* So must the features the checkpoint counts */
+  if( save_features( build, checkpoint.hands_done ) ) {
+    return 1;
+  }
+
+  char tmp_file[ PATH_LENGTH + 4 ];
+  snprintf( tmp_file, sizeof( tmp_file ), "%s.tmp", build.checkpoint_file );
+  FILE *file = fopen( tmp_file, "wb" );
+  if( file == NULL ) {
+    fprintf( stderr, "could not open checkpoint file [%s]\n", tmp_file );
+    return 1;
+  }
+  bool ok = ( fwrite( &checkpoint, sizeof( checkpoint ), 1, file ) == 1 );
+  if( ok && ( checkpoint.phase == PHASE_KMEANS ) ) {
+    ok = ( fwrite( &build.centres[ 0 ], sizeof( double ), build.centres.size( ),
+		   file ) == build.centres.size( ) );
+  }
+  if( fclose( file ) || !ok || rename( tmp_file, build.checkpoint_file ) ) {
+    fprintf( stderr, "failed to write checkpoint file [%s]\n",
+	     build.checkpoint_file );
+    return 1;
+  }
+
+  return 0;
+}
+
+static void init_checkpoint( const build_t &build, checkpoint_t &checkpoint )
+{
+  memset( &checkpoint, 0, sizeof( checkpoint ) );
+  memcpy( checkpoint.magic, CHECKPOINT_MAGIC, sizeof( checkpoint.magic ) );
+  checkpoint.num_rounds = build.game->numRounds;
+  for( int r = 0; r < build.game->numRounds; ++r ) {
+    checkpoint.num_buckets[ r ] = build.num_buckets[ r ];
+  }
+  checkpoint.num_bins = build.num_bins;
+  checkpoint.num_samples = build.num_samples;
+  checkpoint.seed = build.seed;
+}
+
+/* Sets up the round's feature storage */
+static void start_round( build_t &build, const int round )
+{
+  build.round = round;
+  build.dim = ( round == build.game->numRounds - 1 ? 1 : build.num_bins );
+  build.num_hands = build.indexer->get_size( round );
+  build.num_centres = build.num_buckets[ round ];
+  build.features.clear( );
+  build.weights.clear( );
+  build.centres.clear( );
+  build.hands_saved = 0;
+}
+
+/* The round's hands from 0 up to this are all done */
+static int64_t get_hands_done( const std::vector<thread_args_t> &args )
+{
+  int64_t hands_done = args[ 0 ].chunk;
+  for( size_t t = 1; t < args.size( ); ++t ) {
+    hands_done = std::min( hands_done, ( int64_t ) args[ t ].chunk );
+  }
+  /* Their features must be seen after the chunks */
+  __sync_synchronize( );
+  return hands_done;
+}
+
+/* Computes the features of the round's hands from hands_done on.
+ * Returns 0 on success, 1 on failure.
+ */
+static int build_features( build_t &build, checkpoint_t &checkpoint )
+{
+  build.features.resize( build.num_hands * build.dim );
+  build.weights.resize( build.num_hands );
+  std::vector<thread_args_t> args( build.num_threads );
+  for( int t = 0; t < build.num_threads; ++t ) {
+    args[ t ].chunk = checkpoint.hands_done;
+  }
+  build.next_hand = checkpoint.hands_done;
+  build.hands_computed = checkpoint.hands_done;
+
+  /* The threads share out the rest of the round while this one reports
+   * their progress and saves what they have finished
+   */
+  std::vector<pthread_t> threads;
+  std::vector<bool> launched;
+  start_threads( build, feature_thread, args, threads, launched );
+  double last_status = get_seconds( );
+  double last_checkpoint = last_status;
+  int64_t status_hands = build.hands_computed;
+  int failed = 0;
+  while( !failed ) {
+    const int64_t hands_computed
+      = __sync_fetch_and_add( &build.hands_computed, 0 );
+    const double now = get_seconds( );
+    if( ( now - last_status >= build.status_seconds )
+	|| ( hands_computed == build.num_hands ) ) {
+      fprintf( stderr, "Round %d features: %jd / %jd hands, %.0lf hands/s\n",
+	       build.round, ( intmax_t ) hands_computed,
+	       ( intmax_t ) build.num_hands,
+	       ( hands_computed - status_hands )
+	       / std::max( now - last_status, 1e-6 ) );
+      last_status = now;
+      status_hands = hands_computed;
+    }
+    if( hands_computed == build.num_hands ) {
+      break;
+    }
+    if( now - last_checkpoint >= build.checkpoint_seconds ) {
+      checkpoint.hands_done = get_hands_done( args );
+      if( write_checkpoint( build, checkpoint ) ) {
+	/* Hand out no more chunks, so the threads stop soon */
+	__sync_fetch_and_add( &build.next_hand, build.num_hands );
+	failed = 1;
+      }
+      last_checkpoint = now;
+    }
+    usleep( FEATURE_POLL_USECS );
+  }
+  join_threads( threads, launched );
+  if( failed ) {
+    return 1;
+  }
+  checkpoint.hands_done = build.num_hands;
+
+  return 0;
+}
+
+/* Clusters the round's hands into the output table, starting from the
+ * centres in build or, at iteration 0, from randomly chosen hands.
+ * Returns 0 on success, 1 on failure.
+ */
+static int build_clusters( build_t &build, checkpoint_t &checkpoint )
+{
+  const int dim = build.dim;
+  if( checkpoint.iteration == 0 ) {
+    uint64_t rng = ( ( uint64_t ) build.seed << 32 ) ^ ~( uint64_t ) build.round;
+    /* Start from randomly chosen hands with distinct features, giving up
+     * on distinct ones after a while in case there are too few
+     */
+    std::set<std::vector<float> > chosen;
+    build.centres.clear( );
+    int64_t num_tries = 0;
+    while( ( int ) build.centres.size( ) < build.num_centres * dim ) {
+      const int64_t i = splitmix64( rng ) % build.num_hands;
+      const std::vector<float> features( &build.features[ i * dim ],
+					 &build.features[ ( i + 1 ) * dim ] );
+      ++num_tries;
+      if( !chosen.insert( features ).second
+	  && ( num_tries < 64 * ( int64_t ) build.num_centres ) ) {
+	continue;
+      }
+      build.centres.insert( build.centres.end( ), features.begin( ),
+			    features.end( ) );
+    }
+  }
+
+  /* Split the hands evenly and reduce in thread order, so that the result
+   * does not depend on timing
+   */
+  std::vector<thread_args_t> args( build.num_threads );
+  for( int t = 0; t < build.num_threads; ++t ) {
+    args[ t ].begin = build.num_hands * t / build.num_threads;
+    args[ t ].end = build.num_hands * ( t + 1 ) / build.num_threads;
+  }
+
+  double last_status = get_seconds( );
+  double last_checkpoint = last_status;
+  int status_iteration = checkpoint.iteration;
+  int64_t changed = 0;
+  int num_empty = 0;
+  while( checkpoint.iteration < build.max_iterations ) {
+    run_threads( build, kmeans_thread, args );
+    ++checkpoint.iteration;
+
+    /* Restart empty clusters at the hands furthest from their centres,
+     * taking each thread's furthest in turn
+     */
+    int next_furthest = 0;
+    changed = 0;
+    num_empty = 0;
+    for( int c = 0; c < build.num_centres; ++c ) {
+      double total = 0;
+      for( int t = 0; t < build.num_threads; ++t ) {
+	total += args[ t ].totals[ c ];
+      }
+      if( total == 0 ) {
+	++num_empty;
+	while( ( next_furthest < build.num_threads )
+	       && ( args[ next_furthest ].furthest_distance <= 0 ) ) {
+	  ++next_furthest;
+	}
+	if( next_furthest == build.num_threads ) {
+	  /* Every hand sits on its centre, so there are fewer distinct
+	   * hands than clusters
+	   */
+	  continue;
+	}
+	const int64_t i = args[ next_furthest++ ].furthest;
+	for( int d = 0; d < dim; ++d ) {
+	  build.centres[ c * dim + d ] = build.features[ i * dim + d ];
+	}
+	continue;
+      }
+      for( int d = 0; d < dim; ++d ) {
+	double sum = 0;
+	for( int t = 0; t < build.num_threads; ++t ) {
+	  sum += args[ t ].sums[ c * dim + d ];
+	}
+	build.centres[ c * dim + d ] = sum / total;
+      }
+    }
+    for( int t = 0; t < build.num_threads; ++t ) {
+      changed += args[ t ].changed;
+    }
+
+    const double now = get_seconds( );
+    if( now - last_status >= build.status_seconds ) {
+      fprintf( stderr, "Round %d k-means iteration %d: %jd hands moved, "
+	       "%d empty clusters, %.0lf hands/s\n", build.round,
+	       checkpoint.iteration, ( intmax_t ) changed, num_empty,
+	       build.num_hands * ( checkpoint.iteration - status_iteration )
+	       / std::max( now - last_status, 1e-6 ) );
+      last_status = now;
+      status_iteration = checkpoint.iteration;
+    }
+    if( ( changed == 0 ) && ( checkpoint.iteration > 1 ) ) {
+      /* No hand moved, even after restarting any empty clusters */
+      break;
+    }
+    if( now - last_checkpoint >= build.checkpoint_seconds ) {
+      if( write_checkpoint( build, checkpoint ) ) {
+	return 1;
+      }
+      last_checkpoint = now;
+    }
+  }
+
+  fprintf( stderr, "Round %d k-means done after %d iterations: %jd hands "
+	   "moved in the last, %d empty clusters\n", build.round,
+	   checkpoint.iteration, ( intmax_t ) changed, num_empty );
+  return 0;
+}
+
+/* Reads the checkpoint, if any, into checkpoint and build.
+ * Returns 0 on success, 1 on failure.
+ */
+static int load_checkpoint( build_t &build, checkpoint_t &checkpoint,
+			    bool &found )
+{
+  found = false;
+  FILE *file = fopen( build.checkpoint_file, "rb" );
+  if( file == NULL ) {
+    return 0;
+  }
+  found = true;
+
+  checkpoint_t expected;
+  init_checkpoint( build, expected );
+  if( ( fread( &checkpoint, sizeof( checkpoint ), 1, file ) != 1 )
+      || memcmp( &checkpoint, &expected, offsetof( checkpoint_t, round ) ) ) {
+    fprintf( stderr, "checkpoint file [%s] was made with different options\n",
+	     build.checkpoint_file );
+    fclose( file );
+    return 1;
+  }
+
+  start_round( build, checkpoint.round );
+  const size_t num_features = checkpoint.hands_done * build.dim;
+  build.features.resize( build.num_hands * build.dim );
+  build.weights.resize( build.num_hands );
+  bool ok = true;
+  if( num_features > 0 ) {
+    ok = !pread_all( build.features_fd, &build.features[ 0 ],
+		     num_features * sizeof( float ), 0 )
+      && !pread_all( build.features_fd, &build.weights[ 0 ],
+		     checkpoint.hands_done,
+		     ( off_t ) build.num_hands * build.dim * sizeof( float ) );
+  }
+  build.hands_saved = checkpoint.hands_done;
+  if( ok && ( checkpoint.phase == PHASE_KMEANS ) ) {
+    build.centres.resize( build.num_centres * build.dim );
+    ok = ( fread( &build.centres[ 0 ], sizeof( double ), build.centres.size( ),
+		  file ) == build.centres.size( ) );
+  }
+  fclose( file );
+  if( !ok ) {
+    fprintf( stderr, "checkpoint file [%s] or [%s] is truncated\n",
+	     build.checkpoint_file, build.features_file );
+    return 1;
+  }
+
+  fprintf( stderr, "Resuming round %d from checkpoint [%s]\n",
+	   checkpoint.round, build.checkpoint_file );
+  return 0;
+}
+
+/* Creates the output file, or reopens it when resuming, and maps it.
+ * Returns 0 on success, 1 on failure.
+ */
+static int map_output( build_t &build, const bool resuming )
+{
+  if( init_bucket_file_header( build.game, *build.indexer, build.num_buckets,
+			       build.header ) ) {
+    return 1;
+  }
+  const int fd = open( build.output_file,
+		       resuming ? O_RDWR : O_RDWR | O_CREAT | O_TRUNC, 0644 );
+  if( fd < 0 ) {
+    fprintf( stderr, "could not open output file [%s]\n", build.output_file );
+    return 1;
+  }
+  struct stat sb;
+  if( resuming && ( ( fstat( fd, &sb ) == -1 )
+		    || ( ( uint64_t ) sb.st_size != build.header.file_size ) ) ) {
+    fprintf( stderr, "output file [%s] does not match the checkpoint\n",
+	     build.output_file );
+    close( fd );
+    return 1;
+  }
+  if( !resuming && ftruncate( fd, build.header.file_size ) ) {
+    fprintf( stderr, "could not size output file [%s]\n", build.output_file );
+    close( fd );
+    return 1;
+  }
+  void *start = mmap( NULL, build.header.file_size, PROT_READ | PROT_WRITE,
+		      MAP_SHARED, fd, 0 );
+  close( fd );
+  if( start == MAP_FAILED ) {
+    fprintf( stderr, "error mapping output file [%s]\n", build.output_file );
+    return 1;
+  }
+  build.file = ( uint8_t * ) start;
+
+  return 0;
+}
+
+int main( const int argc, const char *argv[] )
+{
+  build_t build;
+  if( parse_args( argc, argv, build ) ) {
+    return 1;
+  }
+  const Game *game = build.game;
+  const HandIndexer indexer( game );
+  /* Strength is heads-up whatever the number of players */
+  Game heads_up = *game;
+  heads_up.numPlayers = 2;
+  const HandEvaluator evaluator( &heads_up );
+  build.indexer = &indexer;
+  build.evaluator = &evaluator;
+
+  build.num_deck_cards = 0;
+  for( int rank = 0; rank < game->numRanks; ++rank ) {
+    for( int suit = 0; suit < game->numSuits; ++suit ) {
+      build.deck[ build.num_deck_cards++ ] = makeCard( rank, suit );
+    }
+  }
+  for( int r = 0; r < game->numRounds; ++r ) {
+    build.num_board_cards[ r ] = sumBoardCards( game, r );
+  }
+  int perm[ MAX_SUITS ];
+  for( int s = 0; s < game->numSuits; ++s ) {
+    perm[ s ] = s;
+  }
+  build.num_suit_perms = 0;
+  do {
+    memcpy( build.suit_perms[ build.num_suit_perms++ ], perm, sizeof( perm ) );
+  } while( std::next_permutation( perm, perm + game->numSuits ) );
+
+  build.features_fd = open( build.features_file, O_RDWR | O_CREAT, 0644 );
+  if( build.features_fd < 0 ) {
+    fprintf( stderr, "could not open features file [%s]\n",
+	     build.features_file );
+    return 1;
+  }
+  checkpoint_t checkpoint;
+  bool resuming;
+  if( load_checkpoint( build, checkpoint, resuming ) ) {
+    return 1;
+  }
+  if( !resuming ) {
+    init_checkpoint( build, checkpoint );
+  }
+  if( map_output( build, resuming ) ) {
+    return 1;
+  }
+
+  const double start = get_seconds( );
+  for( int r = checkpoint.round; r < game->numRounds; ++r ) {
+    if( !resuming ) {
+      checkpoint.round = r;
+      checkpoint.phase = PHASE_FEATURES;
+      checkpoint.iteration = 0;
+      checkpoint.hands_done = 0;
+      start_round( build, r );
+      /* No checkpoint counts on the last round's features any more */
+      if( ftruncate( build.features_fd, 0 ) ) {
+	fprintf( stderr, "could not empty features file [%s]\n",
+		 build.features_file );
+	return 1;
+      }
+    }
+    /* Only the first round can pick up from the checkpoint */
+    resuming = false;
+
+    if( build.num_centres >= build.num_hands ) {
+      /* Lossless: every hand is its own bucket */
+      for( int64_t i = 0; i < build.num_hands; ++i ) {
+	set_table_bucket( build, i, i );
+      }
+      fprintf( stderr, "Round %d: %jd hands, each in its own bucket\n", r,
+	       ( intmax_t ) build.num_hands );
+      continue;
+    }
+
+    if( checkpoint.phase == PHASE_FEATURES ) {
+      if( build_features( build, checkpoint ) ) {
+	return 1;
+      }
+      checkpoint.phase = PHASE_KMEANS;
+      checkpoint.iteration = 0;
+    }
+    if( build_clusters( build, checkpoint ) ) {
+      return 1;
+    }
+    /* Save the finished round so that a later round can resume after it */
+    if( r + 1 < game->numRounds ) {
+      checkpoint_t next = checkpoint;
+      next.round = r + 1;
+      next.phase = PHASE_FEATURES;
+      next.iteration = 0;
+      next.hands_done = 0;
+      if( write_checkpoint( build, next ) ) {
+	return 1;
+      }
+    }
+  }
+
+  /* Finish the header and make the file whole */
+  uint64_t checksum = BUCKET_CHECKSUM_START;
+  for( int r = 0; r < game->numRounds; ++r ) {
+    checksum = bucket_checksum( build.file + build.header.table_offset[ r ],
+				build.header.num_hands[ r ]
+				* build.header.bucket_bytes[ r ], checksum );
+  }
+  build.header.checksum = checksum;
+  memcpy( build.file, &build.header, sizeof( build.header ) );
+  if( msync( build.file, build.header.file_size, MS_SYNC ) ) {
+    fprintf( stderr, "failed to sync [%s]\n", build.output_file );
+    return 1;
+  }
+  munmap( build.file, build.header.file_size );
+  close( build.features_fd );
+  unlink( build.checkpoint_file );
+  unlink( build.features_file );
+
+  fprintf( stderr, "Wrote [%s] in %.1lf seconds\n", build.output_file,
+	   get_seconds( ) - start );
+  return 0;
+}
@@ -7,6 +7,14 @@
  */
 
 /* C / C++ / STL indluces */
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /* project_acpc_server includes */
 extern "C" {
@@ -161,3 +169,184 @@ void BlindCardAbstraction::precompute_buckets( const Game *game, hand_t &hand )
     }
   }
 }
+
+IsomorphicCardAbstraction::IsomorphicCardAbstraction( const Game *game )
+  : indexer( game )
+{
+  for( int r = 0; r < game->numRounds; ++r ) {
+    if( indexer.get_size( r ) > INT_MAX ) {
+      fprintf( stderr, "Isomorphic card abstraction has %jd buckets "
+	       "in round %d, more than fit in a bucket number\n",
+	       ( intmax_t ) indexer.get_size( r ), r );
+      exit( -1 );
+    }
+  }
+}
+
+IsomorphicCardAbstraction::~IsomorphicCardAbstraction( )
+{
+}
+
+int IsomorphicCardAbstraction::num_buckets( const Game *game,
+					    const BettingNode *node ) const
+{
+  return indexer.get_size( node->get_round( ) );
+}
+
+int IsomorphicCardAbstraction::num_buckets( const Game *game,
+					    const State &state ) const
+{
+  return indexer.get_size( state.round );
+}
+
+int IsomorphicCardAbstraction::get_bucket( const Game *game,
+					   const BettingNode *node,
+					   const uint8_t board_cards
+					   [ MAX_BOARD_CARDS ],
+					   const uint8_t hole_cards
+					   [ MAX_PURE_CFR_PLAYERS ]
+					   [ MAX_HOLE_CARDS ] ) const
+{
+  /* Later rounds' board cards may not have been dealt yet */
+  const int round = node->get_round( );
+  int64_t indices[ MAX_ROUNDS ];
+  if( indexer.index_hand( hole_cards[ node->get_player( ) ], board_cards,
+			  round, indices ) ) {
+    fprintf( stderr, "Cannot index an impossible hand, using bucket 0\n" );
+    return 0;
+  }
+  return indices[ round ];
+}
+
+void IsomorphicCardAbstraction::precompute_buckets( const Game *game,
+						    hand_t &hand ) const
+{
+  /* One pass per player indexes every round */
+  for( int p = 0; p < game->numPlayers; ++p ) {
+    int64_t indices[ MAX_ROUNDS ];
+    if( indexer.index_hand( hand.hole_cards[ p ], hand.board_cards,
+			    game->numRounds - 1, indices ) ) {
+      fprintf( stderr, "Cannot index an impossible hand\n" );
+      exit( -1 );
+    }
+    for( int r = 0; r < game->numRounds; ++r ) {
+      hand.precomputed_buckets[ p ][ r ] = indices[ r ];
+    }
+  }
+}
+
+FileCardAbstraction::FileCardAbstraction( const Game *game,
+					  const char *filename )
+  : indexer( game )
+{
+  const int fd = open( filename, O_RDONLY );
+  if( fd < 0 ) {
+    fprintf( stderr, "Could not open bucket file [%s]\n", filename );
+    exit( -1 );
+  }
+  struct stat sb;
+  if( fstat( fd, &sb ) == -1 ) {
+    fprintf( stderr, "Failed to get filesize of bucket file [%s]\n", filename );
+    exit( -1 );
+  }
+  file_size = sb.st_size;
+  if( file_size < sizeof( bucket_file_header_t ) ) {
+    fprintf( stderr, "Bucket file [%s] is too short\n", filename );
+    exit( -1 );
+  }
+  void *start = mmap( NULL, file_size, PROT_READ, MAP_SHARED, fd, 0 );
+  if( start == MAP_FAILED ) {
+    fprintf( stderr, "Error mapping bucket file [%s]\n", filename );
+    exit( -1 );
+  }
+  close( fd );
+
+  /* Lookups land all over the tables, and they will all be needed */
+#ifdef MADV_HUGEPAGE
+  madvise( start, file_size, MADV_HUGEPAGE );
+#endif
+  madvise( start, file_size, MADV_WILLNEED );
+
+  header = ( const bucket_file_header_t * ) start;
+  if( check_bucket_file_header( game, indexer, *header, file_size ) ) {
+    fprintf( stderr, "Bad bucket file [%s]\n", filename );
+    exit( -1 );
+  }
+  uint64_t checksum = BUCKET_CHECKSUM_START;
+  for( int r = 0; r < game->numRounds; ++r ) {
+    tables[ r ] = ( const uint8_t * ) start + header->table_offset[ r ];
+    checksum = bucket_checksum( tables[ r ],
+				header->num_hands[ r ] * header->bucket_bytes[ r ],
+				checksum );
+  }
+  if( checksum != header->checksum ) {
+    fprintf( stderr, "Bucket file [%s] fails its checksum\n", filename );
+    exit( -1 );
+  }
+  madvise( start, file_size, MADV_RANDOM );
+}
+
+FileCardAbstraction::~FileCardAbstraction( )
+{
+  munmap( ( void * ) header, file_size );
+}
+
+int FileCardAbstraction::num_buckets( const Game *game,
+				      const BettingNode *node ) const
+{
+  return header->num_buckets[ node->get_round( ) ];
+}
+
+int FileCardAbstraction::num_buckets( const Game *game,
+				      const State &state ) const
+{
+  return header->num_buckets[ state.round ];
+}
+
+int FileCardAbstraction::get_bucket( const Game *game,
+				     const BettingNode *node,
+				     const uint8_t board_cards
+				     [ MAX_BOARD_CARDS ],
+				     const uint8_t hole_cards
+				     [ MAX_PURE_CFR_PLAYERS ]
+				     [ MAX_HOLE_CARDS ] ) const
+{
+  /* Later rounds' board cards may not have been dealt yet */
+  const int round = node->get_round( );
+  int64_t indices[ MAX_ROUNDS ];
+  if( indexer.index_hand( hole_cards[ node->get_player( ) ], board_cards,
+			  round, indices ) ) {
+    fprintf( stderr, "Cannot index an impossible hand, using bucket 0\n" );
+    return 0;
+  }
+  return lookup_bucket( round, indices[ round ] );
+}
+
+void FileCardAbstraction::precompute_buckets( const Game *game,
+					      hand_t &hand ) const
+{
+  for( int p = 0; p < game->numPlayers; ++p ) {
+    int64_t indices[ MAX_ROUNDS ];
+    if( indexer.index_hand( hand.hole_cards[ p ], hand.board_cards,
+			    game->numRounds - 1, indices ) ) {
+      fprintf( stderr, "Cannot index an impossible hand\n" );
+      exit( -1 );
+    }
+    for( int r = 0; r < game->numRounds; ++r ) {
+      hand.precomputed_buckets[ p ][ r ] = lookup_bucket( r, indices[ r ] );
+    }
+  }
+}
+
+int FileCardAbstraction::lookup_bucket( const int round,
+					const int64_t index ) const
+{
+  switch( header->bucket_bytes[ round ] ) {
+  case 1:
+    return tables[ round ][ index ];
+  case 2:
+    return ( ( const uint16_t * ) tables[ round ] )[ index ];
+  default:
+    return ( ( const uint32_t * ) tables[ round ] )[ index ];
+  }
+}
@@ -19,6 +19,8 @@ extern "C" {
 /* Pure CFR includes */
 #include "constants.hpp"
 #include "betting_node.hpp"
+#include "hand_indexer.hpp"
+#include "bucket_file.hpp"
 
 /* Base class */
 class CardAbstraction {
@@ -37,6 +39,11 @@ public:
   virtual bool can_precompute_buckets( ) const { return false; }
   virtual void precompute_buckets( const Game *game,
 				   hand_t &hand ) const;
+  /* True if a bucket only depends on the player, round and cards, so that
+   * a hand's bucket can be kept once it is computed.  Return false if
+   * buckets also depend on the betting.
+   */
+  virtual bool can_cache_buckets( ) const { return true; }
 
 protected:
 };
@@ -96,4 +103,60 @@ public:
 				   hand_t &hand ) const;
 };
 
+/* The isomorphic card abstraction gives every hand a player can see its own
+ * bucket, up to suit isomorphism and the order in which the cards of a round
+ * were dealt.  Buckets are numbered by a HandIndexer, so none go unused.
+ */
+class IsomorphicCardAbstraction : public CardAbstraction {
+public:
+
+  IsomorphicCardAbstraction( const Game *game );
+  virtual ~IsomorphicCardAbstraction( );
+
+  virtual int num_buckets( const Game *game, const BettingNode *node ) const;
+  virtual int num_buckets( const Game *game, const State &state ) const;
+  virtual int get_bucket( const Game *game,
+			  const BettingNode *node,
+			  const uint8_t board_cards[ MAX_BOARD_CARDS ],
+			  const uint8_t hole_cards[ MAX_PURE_CFR_PLAYERS ]
+			  [ MAX_HOLE_CARDS ] ) const;
+  virtual bool can_precompute_buckets( ) const { return true; }
+  virtual void precompute_buckets( const Game *game,
+				   hand_t &hand ) const;
+
+protected:
+  const HandIndexer indexer;
+};
+
+/* The file card abstraction reads each hand's bucket from a file of
+ * precomputed buckets, indexed as by the isomorphic card abstraction (see
+ * bucket_file.hpp).  The file is mapped read only and shared, so every
+ * process using the same file shares one copy of it in memory.
+ */
+class FileCardAbstraction : public CardAbstraction {
+public:
+
+  FileCardAbstraction( const Game *game, const char *filename );
+  virtual ~FileCardAbstraction( );
+
+  virtual int num_buckets( const Game *game, const BettingNode *node ) const;
+  virtual int num_buckets( const Game *game, const State &state ) const;
+  virtual int get_bucket( const Game *game,
+			  const BettingNode *node,
+			  const uint8_t board_cards[ MAX_BOARD_CARDS ],
+			  const uint8_t hole_cards[ MAX_PURE_CFR_PLAYERS ]
+			  [ MAX_HOLE_CARDS ] ) const;
+  virtual bool can_precompute_buckets( ) const { return true; }
+  virtual void precompute_buckets( const Game *game,
+				   hand_t &hand ) const;
+
+protected:
+  int lookup_bucket( const int round, const int64_t index ) const;
+
+  const HandIndexer indexer;
+  const bucket_file_header_t *header;
+  size_t file_size;
+  const uint8_t *tables[ MAX_ROUNDS ];
+};
+
 #endif
@@ -0,0 +1,216 @@
+/* check_hand_evaluator.cpp
+ * Checks HandEvaluator against rankHand on every set of cards a showdown of
+ * the game can hold, then times both on random deals.
+ */
+
+/* C / C++ / STL includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/game.h"
+}
+
+/* Pure CFR includes */
+#include "hand_evaluator.hpp"
+
+/* Deals served by the benchmark, and times through them */
+static const int BENCH_DEALS = 4096;
+static const int BENCH_PASSES = 200;
+
+static double get_seconds( )
+{
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/* Puts the cards into both state and hand, the first num_board_cards on the
+ * board and the rest in every player's hole
+ */
+static void set_cards( const Game *game, const int *cards,
+		       State &state, hand_t &hand )
+{
+  const int num_board_cards = sumBoardCards( game, game->numRounds - 1 );
+  for( int i = 0; i < num_board_cards; ++i ) {
+    state.boardCards[ i ] = cards[ i ];
+    hand.board_cards[ i ] = cards[ i ];
+  }
+  for( int p = 0; p < game->numPlayers; ++p ) {
+    for( int i = 0; i < game->numHoleCards; ++i ) {
+      state.holeCards[ p ][ i ] = cards[ num_board_cards + i ];
+      hand.hole_cards[ p ][ i ] = cards[ num_board_cards + i ];
+    }
+  }
+}
+
+/* Returns the number of mismatches over every set of showdown cards */
+static int64_t check_every_hand( const Game *game,
+				 const HandEvaluator &evaluator,
+				 int64_t &num_hands )
+{
+  const int num_cards = ( sumBoardCards( game, game->numRounds - 1 )
+			  + game->numHoleCards );
+  const int num_deck_cards = game->numRanks * game->numSuits;
+
+  State state;
+  memset( &state, 0, sizeof( state ) );
+  state.round = game->numRounds - 1;
+  hand_t hand;
+  memset( &hand, 0, sizeof( hand ) );
+
+  /* Step through every set of num_cards deck positions in order */
+  int positions[ MAX_BOARD_CARDS + MAX_HOLE_CARDS ];
+  for( int i = 0; i < num_cards; ++i ) {
+    positions[ i ] = i;
+  }
+  int64_t num_mismatches = 0;
+  num_hands = 0;
+  while( true ) {
+    int cards[ MAX_BOARD_CARDS + MAX_HOLE_CARDS ];
+    for( int i = 0; i < num_cards; ++i ) {
+      cards[ i ] = makeCard( positions[ i ] / game->numSuits,
+			     positions[ i ] % game->numSuits );
+    }
+    set_cards( game, cards, state, hand );
+
+    int ranks[ MAX_PURE_CFR_PLAYERS ];
+    evaluator.rank_hands( hand, ranks );
+    for( int p = 0; p < game->numPlayers; ++p ) {
+      const int expected = rankHand( game, &state, p );
+      if( ranks[ p ] != expected ) {
+	if( num_mismatches < 10 ) {
+	  fprintf( stderr, "hand %jd player %d: rankHand %d, evaluator %d\n",
+		   ( intmax_t ) num_hands, p, expected, ranks[ p ] );
+	}
+	++num_mismatches;
+      }
+    }
+    ++num_hands;
+
+    /* Move on to the next set */
+    int i = num_cards - 1;
+    while( ( i >= 0 ) && ( positions[ i ] == num_deck_cards - num_cards + i ) ) {
+      --i;
+    }
+    if( i < 0 ) {
+      break;
+    }
+    positions[ i ] += 1;
+    for( int j = i + 1; j < num_cards; ++j ) {
+      positions[ j ] = positions[ j - 1 ] + 1;
+    }
+  }
+
+  return num_mismatches;
+}
+
+/* Prints how many deals a second each ranker gets through */
+static void benchmark( const Game *game, const HandEvaluator &evaluator )
+{
+  const int num_board_cards = sumBoardCards( game, game->numRounds - 1 );
+  const int num_deck_cards = game->numRanks * game->numSuits;
+  State *states = new State[ BENCH_DEALS ];
+  hand_t *hands = new hand_t[ BENCH_DEALS ];
+  memset( states, 0, BENCH_DEALS * sizeof( states[ 0 ] ) );
+  memset( hands, 0, BENCH_DEALS * sizeof( hands[ 0 ] ) );
+
+  /* Random deals, fixed so that runs can be compared */
+  srand( 1 );
+  for( int k = 0; k < BENCH_DEALS; ++k ) {
+    bool used[ MAX_SUITS * MAX_RANKS ];
+    memset( used, 0, sizeof( used ) );
+    states[ k ].round = game->numRounds - 1;
+    for( int i = 0; i < num_board_cards + game->numPlayers * game->numHoleCards;
+	 ++i ) {
+      int position;
+      do {
+	position = rand( ) % num_deck_cards;
+      } while( used[ position ] );
+      used[ position ] = true;
+      const int card = makeCard( position / game->numSuits,
+				 position % game->numSuits );
+      if( i < num_board_cards ) {
+	states[ k ].boardCards[ i ] = card;
+	hands[ k ].board_cards[ i ] = card;
+      } else {
+	const int p = ( i - num_board_cards ) / game->numHoleCards;
+	const int c = ( i - num_board_cards ) % game->numHoleCards;
+	states[ k ].holeCards[ p ][ c ] = card;
+	hands[ k ].hole_cards[ p ][ c ] = card;
+      }
+    }
+  }
+
+  int64_t rank_hand_sum = 0;
+  double start = get_seconds( );
+  for( int pass = 0; pass < BENCH_PASSES; ++pass ) {
+    for( int k = 0; k < BENCH_DEALS; ++k ) {
+      for( int p = 0; p < game->numPlayers; ++p ) {
+	rank_hand_sum += rankHand( game, &states[ k ], p );
+      }
+    }
+  }
+  const double rank_hand_secs = get_seconds( ) - start;
+
+  int64_t evaluator_sum = 0;
+  start = get_seconds( );
+  for( int pass = 0; pass < BENCH_PASSES; ++pass ) {
+    for( int k = 0; k < BENCH_DEALS; ++k ) {
+      int ranks[ MAX_PURE_CFR_PLAYERS ];
+      evaluator.rank_hands( hands[ k ], ranks );
+      for( int p = 0; p < game->numPlayers; ++p ) {
+	evaluator_sum += ranks[ p ];
+      }
+    }
+  }
+  const double evaluator_secs = get_seconds( ) - start;
+
+  const double num_deals = ( double ) BENCH_DEALS * BENCH_PASSES;
+  fprintf( stderr, "rankHand %.2fM deals/s, evaluator %.2fM deals/s%s\n",
+	   num_deals / rank_hand_secs / 1e6, num_deals / evaluator_secs / 1e6,
+	   ( rank_hand_sum == evaluator_sum ? "" : " (ranks differ!)" ) );
+
+  delete [] hands;
+  delete [] states;
+}
+
+int main( const int argc, const char *argv[] )
+{
+  if( argc < 2 ) {
+    fprintf( stderr, "Usage: %s <game_file> [--no-bench]\n", argv[ 0 ] );
+    return 1;
+  }
+
+  FILE *file = fopen( argv[ 1 ], "r" );
+  if( file == NULL ) {
+    fprintf( stderr, "Could not open game file [%s]\n", argv[ 1 ] );
+    return 1;
+  }
+  Game *game = readGame( file );
+  fclose( file );
+  if( game == NULL ) {
+    fprintf( stderr, "Could not read game file [%s]\n", argv[ 1 ] );
+    return 1;
+  }
+
+  HandEvaluator evaluator( game );
+  fprintf( stderr, "%s: tables %s\n", argv[ 1 ],
+	   ( evaluator.is_supported( ) ? "used" : "not used" ) );
+
+  int64_t num_hands;
+  const int64_t num_mismatches = check_every_hand( game, evaluator, num_hands );
+  fprintf( stderr, "%jd hands checked, %jd mismatches\n",
+	   ( intmax_t ) num_hands, ( intmax_t ) num_mismatches );
+
+  if( ( argc < 3 ) || strcmp( argv[ 2 ], "--no-bench" ) ) {
+    benchmark( game, evaluator );
+  }
+
+  free( game );
+  return ( num_mismatches > 0 );
+}
@@ -0,0 +1,204 @@
+/* check_hand_indexer.cpp
+ * Checks that HandIndexer's indices round-trip through unindex_hand, that
+ * relabelling suits or reordering cards within a round keeps a hand's index,
+ * and optionally that each round has the expected number of indices.
+ */
+
+/* C / C++ / STL includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/game.h"
+}
+
+/* Pure CFR includes */
+#include "hand_indexer.hpp"
+
+/* Rounds with at most this many indices have every index round-tripped, and
+ * larger rounds a random sample of this many
+ */
+static const int64_t MAX_EXHAUSTIVE_INDICES = 2000000;
+/* Random deals whose index is compared with that of a relabelled copy */
+static const int NUM_RELABELLED_DEALS = 1000000;
+
+/* A random number in [0, bound), fixed from run to run */
+static int64_t random_below( const int64_t bound )
+{
+  const uint64_t r = ( ( uint64_t ) rand( ) << 31 ) ^ ( uint64_t ) rand( );
+  return r % bound;
+}
+
+/* Returns 1 if index in round does not come back from its own hand */
+static int check_index( const HandIndexer &indexer, const int round,
+			const int64_t index )
+{
+  uint8_t hole_cards[ MAX_HOLE_CARDS ];
+  uint8_t board_cards[ MAX_BOARD_CARDS ];
+  memset( board_cards, 0, sizeof( board_cards ) );
+  indexer.unindex_hand( round, index, hole_cards, board_cards );
+  int64_t indices[ MAX_ROUNDS ];
+  if( indexer.index_hand( hole_cards, board_cards, round, indices ) ) {
+    fprintf( stderr, "round %d index %" PRId64 " unindexes to an impossible "
+	     "hand\n", round, index );
+    return 1;
+  }
+  if( indices[ round ] != index ) {
+    fprintf( stderr, "round %d index %" PRId64 " comes back as %" PRId64 "\n",
+	     round, index, indices[ round ] );
+    return 1;
+  }
+  return 0;
+}
+
+/* Shuffles cards[ 0 .. num_cards - 1 ] */
+static void shuffle_cards( uint8_t *cards, const int num_cards )
+{
+  for( int i = num_cards - 1; i > 0; --i ) {
+    const int j = random_below( i + 1 );
+    const uint8_t temp = cards[ i ];
+    cards[ i ] = cards[ j ];
+    cards[ j ] = temp;
+  }
+}
+
+/* Returns 1 if a random deal and a copy with its suits relabelled and each
+ * round's cards reordered get different indices in some round
+ */
+static int check_relabelled( const Game *game, const HandIndexer &indexer )
+{
+  const int num_deck_cards = game->numRanks * game->numSuits;
+  const int num_board_cards = sumBoardCards( game, game->numRounds - 1 );
+
+  /* Deal the hole cards and the whole board */
+  uint8_t deck[ MAX_SUITS * MAX_RANKS ];
+  for( int i = 0; i < num_deck_cards; ++i ) {
+    deck[ i ] = makeCard( i / game->numSuits, i % game->numSuits );
+  }
+  for( int i = 0; i < game->numHoleCards + num_board_cards; ++i ) {
+    const int j = i + random_below( num_deck_cards - i );
+    const uint8_t temp = deck[ i ];
+    deck[ i ] = deck[ j ];
+    deck[ j ] = temp;
+  }
+  uint8_t hole_cards[ MAX_HOLE_CARDS ];
+  uint8_t board_cards[ MAX_BOARD_CARDS ];
+  memcpy( hole_cards, deck, game->numHoleCards );
+  memcpy( board_cards, &deck[ game->numHoleCards ], num_board_cards );
+
+  /* Relabel the suits and reorder the cards of each round */
+  int suits[ MAX_SUITS ];
+  for( int s = 0; s < game->numSuits; ++s ) {
+    suits[ s ] = s;
+  }
+  for( int s = game->numSuits - 1; s > 0; --s ) {
+    const int t = random_below( s + 1 );
+    const int temp = suits[ s ];
+    suits[ s ] = suits[ t ];
+    suits[ t ] = temp;
+  }
+  uint8_t new_hole_cards[ MAX_HOLE_CARDS ];
+  uint8_t new_board_cards[ MAX_BOARD_CARDS ];
+  for( int i = 0; i < game->numHoleCards; ++i ) {
+    new_hole_cards[ i ] = makeCard( rankOfCard( hole_cards[ i ] ),
+				    suits[ suitOfCard( hole_cards[ i ] ) ] );
+  }
+  for( int i = 0; i < num_board_cards; ++i ) {
+    new_board_cards[ i ] = makeCard( rankOfCard( board_cards[ i ] ),
+				     suits[ suitOfCard( board_cards[ i ] ) ] );
+  }
+  shuffle_cards( new_hole_cards, game->numHoleCards );
+  for( int r = 0; r < game->numRounds; ++r ) {
+    const int start = ( r == 0 ? 0 : sumBoardCards( game, r - 1 ) );
+    shuffle_cards( &new_board_cards[ start ], game->numBoardCards[ r ] );
+  }
+
+  int64_t indices[ MAX_ROUNDS ];
+  int64_t new_indices[ MAX_ROUNDS ];
+  if( indexer.index_hand( hole_cards, board_cards, game->numRounds - 1,
+			  indices )
+      || indexer.index_hand( new_hole_cards, new_board_cards,
+			     game->numRounds - 1, new_indices ) ) {
+    fprintf( stderr, "a dealt hand could not be indexed\n" );
+    return 1;
+  }
+  for( int r = 0; r < game->numRounds; ++r ) {
+    if( indices[ r ] != new_indices[ r ] ) {
+      fprintf( stderr, "round %d: index %" PRId64 " becomes %" PRId64 " once "
+	       "relabelled\n", r, indices[ r ], new_indices[ r ] );
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int main( const int argc, const char *argv[] )
+{
+  if( argc < 2 ) {
+    fprintf( stderr, "Usage: %s <game_file> [size_round_0 size_round_1 ...]\n",
+	     argv[ 0 ] );
+    return 1;
+  }
+
+  FILE *file = fopen( argv[ 1 ], "r" );
+  if( file == NULL ) {
+    fprintf( stderr, "Could not open game file [%s]\n", argv[ 1 ] );
+    return 1;
+  }
+  Game *game = readGame( file );
+  fclose( file );
+  if( game == NULL ) {
+    fprintf( stderr, "Could not read game file [%s]\n", argv[ 1 ] );
+    return 1;
+  }
+  if( argc > 2 + game->numRounds ) {
+    fprintf( stderr, "More sizes given than the game has rounds\n" );
+    return 1;
+  }
+
+  HandIndexer indexer( game );
+  srand( 1 );
+  int num_failures = 0;
+  for( int r = 0; r < game->numRounds; ++r ) {
+    const int64_t size = indexer.get_size( r );
+    fprintf( stderr, "round %d: %" PRId64 " indices", r, size );
+    if( r + 2 < argc ) {
+      const int64_t expected = strtoll( argv[ r + 2 ], NULL, 10 );
+      if( size != expected ) {
+	fprintf( stderr, ", expected %" PRId64, expected );
+	++num_failures;
+      }
+    }
+
+    int num_bad = 0;
+    if( size <= MAX_EXHAUSTIVE_INDICES ) {
+      for( int64_t index = 0; index < size; ++index ) {
+	num_bad += check_index( indexer, r, index );
+      }
+      fprintf( stderr, ", all round-tripped" );
+    } else {
+      for( int64_t i = 0; i < MAX_EXHAUSTIVE_INDICES; ++i ) {
+	num_bad += check_index( indexer, r, random_below( size ) );
+      }
+      fprintf( stderr, ", %" PRId64 " sampled and round-tripped",
+	       MAX_EXHAUSTIVE_INDICES );
+    }
+    fprintf( stderr, ", %d failures\n", num_bad );
+    num_failures += num_bad;
+  }
+
+  int num_bad = 0;
+  for( int i = 0; i < NUM_RELABELLED_DEALS; ++i ) {
+    num_bad += check_relabelled( game, indexer );
+  }
+  fprintf( stderr, "%d relabelled deals, %d failures\n",
+	   NUM_RELABELLED_DEALS, num_bad );
+  num_failures += num_bad;
+
+  free( game );
+  return ( num_failures > 0 );
+}
@@ -13,10 +13,25 @@
 #include "constants.hpp"
 
 const char card_abs_type_to_str[ NUM_CARD_ABS_TYPES ][ PATH_LENGTH ]
-= { "NULL", "BLIND" };
+= { "NULL", "BLIND", "ISOMORPHIC", "FILE" };
 
 const char action_abs_type_to_str[ NUM_ACTION_ABS_TYPES ][ PATH_LENGTH ]
-= { "NULL", "FCPA" };
+= { "NULL", "FCPA", "CONFIGURABLE" };
+
+const char checkpoint_mode_to_str[ NUM_CHECKPOINT_MODES ][ PATH_LENGTH ]
+= { "BLOCKING", "FORK" };
+
+const char affinity_type_to_str[ NUM_AFFINITY_TYPES ][ PATH_LENGTH ]
+= { "NONE", "COMPACT", "SCATTER", "LIST" };
+
+const char rng_type_to_str[ NUM_RNG_TYPES ][ PATH_LENGTH ]
+= { "MT", "XOSHIRO" };
+
+const char chance_sampling_to_str[ NUM_CHANCE_SAMPLING_TYPES ][ PATH_LENGTH ]
+= { "UNIFORM", "PARTITIONED", "PUBLIC", "STRATIFIED" };
+
+const char entry_type_to_str[ TYPE_NUM_TYPES ][ PATH_LENGTH ]
+= { "UINT8", "INT", "UINT32", "UINT64", "INT64" };
 
 /* Store regrets as ints because they can have either sign and typically don't get "too" positive */
 const pure_cfr_entry_type_t
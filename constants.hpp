@@ -20,22 +20,48 @@ extern "C" {
 /* pure cfr includes */
 
 /* Maximum number of players this program can handle right now */
-const int MAX_PURE_CFR_PLAYERS = 3;
+const int MAX_PURE_CFR_PLAYERS = 6;
 
-/* Maximum number of abstract actions a player can choose from */
-const int MAX_ABSTRACT_ACTIONS = 4;
+/* Maximum number of abstract actions a player can choose from.  This only
+ * caps what an action abstraction may offer; per-action arrays are sized
+ * from the largest number actually used by a game's tree, found when the
+ * tree is built (see --plan).
+ */
+const int MAX_ABSTRACT_ACTIONS = 64;
 
 /* Length of strings used for filenames */
 const int PATH_LENGTH = 1024;
 
-/* Number of iterations to run per thread before checking for pause or quit */
-const int ITERATION_BLOCK_SIZE = 1000;
+/* Number of bins in the saturation histograms of the regret and avg strategy
+ * tables.  Bin b counts entries with exactly b unused high-order bits,
+ * except the last bin which counts entries with b or more.
+ */
+const int NUM_SATURATION_BINS = 8;
+
+/* Largest number of worker threads, including any added at runtime */
+const int MAX_WORKER_THREADS = 256;
+
+/* Size in bytes of a cache line.  Data written often by one thread is kept
+ * on its own line so that other threads do not contend for it.
+ */
+const int CACHE_LINE_SIZE = 64;
+
+/* Number of iterations each thread runs per epoch in deterministic mode */
+const int DETERMINISTIC_EPOCH_ITERATIONS = 1000;
+
+/* Largest number of hands a thread can sample at once with --hand-batch */
+const int MAX_HAND_BATCH = 4096;
+
+/* Largest number of hands in each worker's ring with --hand-producers */
+const int MAX_HAND_RING_DEPTH = 65536;
 
 /* Enum of card abstraction types */
 typedef enum {
   CARD_ABS_NULL = 0,
   CARD_ABS_BLIND = 1,
-  NUM_CARD_ABS_TYPES = 2
+  CARD_ABS_ISOMORPHIC = 2,
+  CARD_ABS_FILE = 3,
+  NUM_CARD_ABS_TYPES = 4
 } card_abs_type_t;
 extern const char card_abs_type_to_str[ NUM_CARD_ABS_TYPES ][ PATH_LENGTH ];
 
@@ -43,21 +69,58 @@ extern const char card_abs_type_to_str[ NUM_CARD_ABS_TYPES ][ PATH_LENGTH ];
 typedef enum {
   ACTION_ABS_NULL = 0,
   ACTION_ABS_FCPA = 1,
-  NUM_ACTION_ABS_TYPES = 2
+  ACTION_ABS_CONFIGURABLE = 2,
+  NUM_ACTION_ABS_TYPES = 3
 } action_abs_type_t;
 extern const char action_abs_type_to_str[ NUM_ACTION_ABS_TYPES ][ PATH_LENGTH ];
 
-/* Enum of all possible combinations of players that have not folded at a leaf */
+/* Enum of checkpoint modes */
+typedef enum {
+  CHECKPOINT_BLOCKING = 0, /* workers stay paused while the dump is written */
+  CHECKPOINT_FORK = 1, /* a forked child writes a copy-on-write snapshot */
+  NUM_CHECKPOINT_MODES = 2
+} checkpoint_mode_t;
+extern const char checkpoint_mode_to_str[ NUM_CHECKPOINT_MODES ][ PATH_LENGTH ];
+
+/* Maximum number of CPUs that worker threads can be pinned to */
+const int MAX_AFFINITY_CPUS = 1024;
+
+/* Enum of worker thread placement policies */
 typedef enum {
-  LEAF_P0 = 0,
-  LEAF_P1 = 1,
-  LEAF_P0_P1 = 2,
-  LEAF_P2 = 3,
-  LEAF_P0_P2 = 4,
-  LEAF_P1_P2 = 5,
-  LEAF_P0_P1_P2 = 6,
-  LEAF_NUM_TYPES = 7
-} leaf_type_t;
+  AFFINITY_NONE = 0,
+  AFFINITY_COMPACT = 1,
+  AFFINITY_SCATTER = 2,
+  AFFINITY_LIST = 3,
+  NUM_AFFINITY_TYPES = 4
+} affinity_type_t;
+extern const char affinity_type_to_str[ NUM_AFFINITY_TYPES ][ PATH_LENGTH ];
+
+/* Enum of random number generators used by the worker threads */
+typedef enum {
+  RNG_MT = 0, /* Mersenne Twister, drawing exactly as earlier versions did */
+  RNG_XOSHIRO = 1, /* xoshiro256** with unbiased bounded draws */
+  NUM_RNG_TYPES = 2
+} rng_type_t;
+extern const char rng_type_to_str[ NUM_RNG_TYPES ][ PATH_LENGTH ];
+
+/* Enum of ways worker threads sample chance outcomes */
+typedef enum {
+  CHANCE_SAMPLING_UNIFORM = 0, /* every thread samples every deal */
+  CHANCE_SAMPLING_PARTITIONED = 1, /* threads take turns over player 0's
+				    * first hole card */
+  CHANCE_SAMPLING_PUBLIC = 2, /* sample only the board and walk every
+			       * private hand at once (2p only) */
+  CHANCE_SAMPLING_STRATIFIED = 3, /* threads cycle through player 0's hole
+				   * cards in a shuffled order */
+  NUM_CHANCE_SAMPLING_TYPES = 4
+} chance_sampling_t;
+extern const char
+chance_sampling_to_str[ NUM_CHANCE_SAMPLING_TYPES ][ PATH_LENGTH ];
+
+/* Number of iterations a thread runs with one card forced before moving on
+ * to the next card under CHANCE_SAMPLING_PARTITIONED
+ */
+const int CHANCE_PARTITION_BLOCK_SIZE = 1000;
 
 /* Possible regret and average strategy storage types */
 typedef enum {
@@ -65,9 +128,14 @@ typedef enum {
   TYPE_INT = 1,
   TYPE_UINT32_T = 2,
   TYPE_UINT64_T = 3,
-  TYPE_NUM_TYPES = 4
+  TYPE_INT64_T = 4,
+  TYPE_NUM_TYPES = 5
 } pure_cfr_entry_type_t;
+extern const char entry_type_to_str[ TYPE_NUM_TYPES ][ PATH_LENGTH ];
 
+/* Default storage types per round, overridden by --regret-types and
+ * --avg-types
+ */
 extern const pure_cfr_entry_type_t
 REGRET_TYPES[ MAX_ROUNDS ];
 
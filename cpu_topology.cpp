@@ -0,0 +1,135 @@
+/* cpu_topology.cpp
+ * Discovers which CPUs the process may run on and how they are arranged
+ * into packages, cores and hyperthreads, and pins worker threads to them.
+ */
+
+/* C / C++ / STL includes */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Pure CFR includes */
+#include "cpu_topology.hpp"
+
+/* Reads a single integer from a sysfs file, returning -1 on failure */
+static int read_sysfs_int( const int cpu, const char *name )
+{
+  char filename[ PATH_LENGTH ];
+  snprintf( filename, PATH_LENGTH,
+	    "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name );
+  FILE *file = fopen( filename, "r" );
+  if( file == NULL ) {
+    return -1;
+  }
+  int value;
+  if( fscanf( file, "%d", &value ) < 1 ) {
+    value = -1;
+  }
+  fclose( file );
+  return value;
+}
+
+int get_cpu_topology( cpu_info_t *cpus, const int max_cpus )
+{
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO( &allowed );
+  if( sched_getaffinity( 0, sizeof( allowed ), &allowed ) ) {
+    return 0;
+  }
+
+  int num_cpus = 0;
+  for( int c = 0; ( c < CPU_SETSIZE ) && ( num_cpus < max_cpus ); ++c ) {
+    if( !CPU_ISSET( c, &allowed ) ) {
+      continue;
+    }
+    cpus[ num_cpus ].cpu = c;
+    cpus[ num_cpus ].package = read_sysfs_int( c, "physical_package_id" );
+    cpus[ num_cpus ].core = read_sysfs_int( c, "core_id" );
+    cpus[ num_cpus ].core_rank = 0;
+    if( cpus[ num_cpus ].package < 0 ) {
+      cpus[ num_cpus ].package = 0;
+    }
+    if( cpus[ num_cpus ].core < 0 ) {
+      /* No topology information, so treat every CPU as its own core */
+      cpus[ num_cpus ].core = c;
+    }
+
+    /* Number the hyperthreads of each core in the order we find them */
+    cpus[ num_cpus ].smt = 0;
+    for( int i = 0; i < num_cpus; ++i ) {
+      if( ( cpus[ i ].package == cpus[ num_cpus ].package )
+	  && ( cpus[ i ].core == cpus[ num_cpus ].core ) ) {
+	cpus[ num_cpus ].smt += 1;
+      }
+    }
+    ++num_cpus;
+  }
+
+  return num_cpus;
+#else
+  return 0;
+#endif
+}
+
+static int compare_compact( const void *a, const void *b )
+{
+  const cpu_info_t *x = ( const cpu_info_t * ) a;
+  const cpu_info_t *y = ( const cpu_info_t * ) b;
+  if( x->package != y->package ) {
+    return x->package - y->package;
+  }
+  if( x->core != y->core ) {
+    return x->core - y->core;
+  }
+  return x->smt - y->smt;
+}
+
+static int compare_scatter( const void *a, const void *b )
+{
+  const cpu_info_t *x = ( const cpu_info_t * ) a;
+  const cpu_info_t *y = ( const cpu_info_t * ) b;
+  if( x->smt != y->smt ) {
+    return x->smt - y->smt;
+  }
+  if( x->core_rank != y->core_rank ) {
+    return x->core_rank - y->core_rank;
+  }
+  return x->package - y->package;
+}
+
+void order_cpus( const affinity_type_t type, cpu_info_t *cpus,
+		 const int num_cpus )
+{
+  qsort( cpus, num_cpus, sizeof( cpus[ 0 ] ), compare_compact );
+
+  /* Core ids need not be contiguous, so rank the cores of each package */
+  for( int i = 0; i < num_cpus; ++i ) {
+    if( ( i == 0 ) || ( cpus[ i ].package != cpus[ i - 1 ].package ) ) {
+      cpus[ i ].core_rank = 0;
+    } else if( cpus[ i ].core != cpus[ i - 1 ].core ) {
+      cpus[ i ].core_rank = cpus[ i - 1 ].core_rank + 1;
+    } else {
+      cpus[ i ].core_rank = cpus[ i - 1 ].core_rank;
+    }
+  }
+
+  if( type == AFFINITY_SCATTER ) {
+    qsort( cpus, num_cpus, sizeof( cpus[ 0 ] ), compare_scatter );
+  }
+}
+
+int pin_thread_to_cpu( pthread_t thread, const int cpu )
+{
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  CPU_SET( cpu, &set );
+  return pthread_setaffinity_np( thread, sizeof( set ), &set );
+#else
+  return 1;
+#endif
+}
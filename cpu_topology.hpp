@@ -0,0 +1,41 @@
+#ifndef __PURE_CFR_CPU_TOPOLOGY_HPP__
+#define __PURE_CFR_CPU_TOPOLOGY_HPP__
+
+/* cpu_topology.hpp
+ * Discovers which CPUs the process may run on and how they are arranged
+ * into packages, cores and hyperthreads, and pins worker threads to them.
+ */
+
+/* C / C++ / STL includes */
+#include <pthread.h>
+#include <stdio.h>
+
+/* Pure CFR includes */
+#include "constants.hpp"
+
+typedef struct {
+  int cpu; /* operating system CPU number */
+  int package; /* physical package (socket) */
+  int core; /* core id within the package */
+  int core_rank; /* position of the core among the cores of its package */
+  int smt; /* index of this hyperthread among the threads of its core */
+} cpu_info_t;
+
+/* Fills cpus with up to max_cpus CPUs this process is allowed to run on.
+ * Returns the number of CPUs found, or 0 if the topology is unavailable.
+ */
+int get_cpu_topology( cpu_info_t *cpus, const int max_cpus );
+
+/* Orders the CPUs in cpus according to the placement policy.
+ * COMPACT fills every hyperthread of a core before moving on to the next
+ * core, and every core of a package before moving on to the next package.
+ * SCATTER places one thread on each physical core, alternating between
+ * packages, before doubling up on hyperthread siblings.
+ */
+void order_cpus( const affinity_type_t type, cpu_info_t *cpus,
+		 const int num_cpus );
+
+/* Pins the thread to a single CPU.  Returns 0 on success. */
+int pin_thread_to_cpu( pthread_t thread, const int cpu );
+
+#endif
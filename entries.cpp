@@ -25,7 +25,8 @@ extern "C" {
 Entries::Entries( size_t new_num_entries_per_bucket,
 		  size_t new_total_num_entries )
   : num_entries_per_bucket( new_num_entries_per_bucket ),
-    total_num_entries( new_total_num_entries )
+    total_num_entries( new_total_num_entries ),
+    num_dropped( 0 )
 {
 }
 
@@ -33,6 +34,22 @@ Entries::~Entries( )
 {
 }
 
+void init_saturation( saturation_t &sat )
+{
+  memset( sat.histogram, 0, NUM_SATURATION_BINS * sizeof( sat.histogram[ 0 ] ) );
+  sat.max_abs_value = 0;
+}
+
+void add_saturation( saturation_t &sat, const saturation_t &other )
+{
+  for( int b = 0; b < NUM_SATURATION_BINS; ++b ) {
+    sat.histogram[ b ] += other.histogram[ b ];
+  }
+  if( other.max_abs_value > sat.max_abs_value ) {
+    sat.max_abs_value = other.max_abs_value;
+  }
+}
+
 size_t Entries::get_entry_index( const int bucket, const int64_t soln_idx ) const
 {
   return ( num_entries_per_bucket * bucket ) + soln_idx;
@@ -89,6 +106,15 @@ Entries *new_loaded_entries( const size_t num_entries_per_bucket,
     break;
   }
 
+  case TYPE_INT64_T: {
+    int64_t *int64_t_data = ( int64_t * ) ( *data );
+    entries = new Entries_der<int64_t>( num_entries_per_bucket,
+					total_num_entries, int64_t_data );
+    int64_t_data += total_num_entries;
+    ( *data ) = ( void * ) int64_t_data;
+    break;
+  }
+
   default: {
     fprintf( stderr, "unrecognized entry type [%d]\n", type );
     break;
@@ -97,3 +123,50 @@ Entries *new_loaded_entries( const size_t num_entries_per_bucket,
 
   return entries;
 }
+
+Entries *new_entries( const pure_cfr_entry_type_t type,
+		      const size_t num_entries_per_bucket,
+		      const size_t total_num_entries )
+{
+  switch( type ) {
+  case TYPE_UINT8_T:
+    return new Entries_der<uint8_t>( num_entries_per_bucket, total_num_entries );
+
+  case TYPE_INT:
+    return new Entries_der<int>( num_entries_per_bucket, total_num_entries );
+
+  case TYPE_UINT32_T:
+    return new Entries_der<uint32_t>( num_entries_per_bucket,
+				      total_num_entries );
+
+  case TYPE_UINT64_T:
+    return new Entries_der<uint64_t>( num_entries_per_bucket,
+				      total_num_entries );
+
+  case TYPE_INT64_T:
+    return new Entries_der<int64_t>( num_entries_per_bucket,
+				     total_num_entries );
+
+  default:
+    fprintf( stderr, "unrecognized entry type [%d]\n", type );
+    return NULL;
+  }
+}
+
+size_t entry_type_size( const pure_cfr_entry_type_t type )
+{
+  switch( type ) {
+  case TYPE_UINT8_T:
+    return sizeof( uint8_t );
+  case TYPE_INT:
+    return sizeof( int );
+  case TYPE_UINT32_T:
+    return sizeof( uint32_t );
+  case TYPE_UINT64_T:
+    return sizeof( uint64_t );
+  case TYPE_INT64_T:
+    return sizeof( int64_t );
+  default:
+    return 0;
+  }
+}
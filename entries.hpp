@@ -13,6 +13,7 @@
 /* C / C++ / STL includes */
 #include <assert.h>
 #include <typeinfo>
+#include <limits>
 
 /* C project-acpc-poker includes */
 extern "C" {
@@ -21,6 +22,15 @@ extern "C" {
 /* Pure CFR includes */
 #include "constants.hpp"
 
+/* How close the values in a range of entries are to the limits of their type */
+typedef struct {
+  uint64_t histogram[ NUM_SATURATION_BINS ];
+  uint64_t max_abs_value;
+} saturation_t;
+
+void init_saturation( saturation_t &sat );
+void add_saturation( saturation_t &sat, const saturation_t &other );
+
 class Entries {
 public:
 
@@ -46,11 +56,21 @@ public:
 
   virtual pure_cfr_entry_type_t get_entry_type( ) const = 0;
 
+  /* Adds the saturation of entries [begin, end) to sat */
+  virtual void get_saturation( const size_t begin,
+			       const size_t end,
+			       saturation_t &sat ) const = 0;
+
+  size_t get_total_num_entries( ) const { return total_num_entries; }
+  /* Number of updates discarded because they would have overflowed */
+  uint64_t get_num_dropped( ) const { return num_dropped; }
+
 protected:
   size_t get_entry_index( const int bucket, const int64_t soln_idx ) const;
 
   const size_t num_entries_per_bucket;
   const size_t total_num_entries;
+  uint64_t num_dropped;
 };
 
 template <typename T>
@@ -80,6 +100,10 @@ public:
 
   virtual pure_cfr_entry_type_t get_entry_type( ) const;
 
+  virtual void get_saturation( const size_t begin,
+			       const size_t end,
+			       saturation_t &sat ) const;
+
   virtual void get_values( const int bucket,
 			   const int64_t soln_idx,
 			   const int num_choices,
@@ -99,6 +123,16 @@ Entries *new_loaded_entries( size_t num_entries_per_bucket,
 			     size_t total_num_entries,
 			     void **data );
 
+/* Allocates zeroed entries of the given type.  Returns NULL if the type is
+ * not recognized.
+ */
+Entries *new_entries( const pure_cfr_entry_type_t type,
+		      size_t num_entries_per_bucket,
+		      size_t total_num_entries );
+
+/* Size in bytes of a single entry of the given type, 0 if not recognized */
+size_t entry_type_size( const pure_cfr_entry_type_t type );
+
 /* Unfortunately, templates require definitions in the same file
  * as their declarations
  */
@@ -114,7 +148,8 @@ Entries_der<T>::Entries_der( size_t new_num_entries_per_bucket,
   } else {
     entries = ( T * ) calloc( total_num_entries, sizeof( T ) );
     /* If you hit this assert, you have run out of RAM!
-     * Use a smaller game or coarser abstractions.
+     * Use a smaller game, coarser abstractions or smaller entry types.
+     * Running pure_cfr with --plan reports the memory required.
      */
     assert( entries != NULL );
   }
@@ -161,14 +196,20 @@ void Entries_der<T>::update_regret( const int bucket,
   /* Get a pointer to the local entries at this index */
   size_t base_index = get_entry_index( bucket, soln_idx );
   T *local_entries = &entries[ base_index ];
+  const T max_value = std::numeric_limits<T>::max( );
+  const T min_value = std::numeric_limits<T>::min( );
 
   for( int c = 0; c < num_choices; ++c ) {
     int diff = values[ c ] - retval;
-    T new_regret = local_entries[ c ] + diff;
-    /* Only update regret if no overflow occurs */
-    if( ( ( diff < 0 ) && ( new_regret < local_entries[ c ] ) )
-	|| ( ( diff > 0 ) && ( new_regret > local_entries[ c ] ) ) ) {
-      local_entries[ c ] = new_regret;
+    /* Only update regret if no overflow occurs, checking before adding
+     * so that we never rely on wrap-around
+     */
+    if( ( ( diff > 0 ) && ( local_entries[ c ] > max_value - diff ) )
+	|| ( ( diff < 0 ) && ( local_entries[ c ] < min_value - diff ) ) ) {
+      /* Rare, so the atomic add costs nothing in the common case */
+      __sync_fetch_and_add( &num_dropped, 1 );
+    } else if( diff != 0 ) {
+      local_entries[ c ] += diff;
     }
   }
 }
@@ -180,12 +221,12 @@ int Entries_der<T>::increment_entry( const int bucket, const int64_t soln_idx, c
   size_t base_index = get_entry_index( bucket, soln_idx );
   T *local_entries = &entries[ base_index ];
 
-  local_entries[ choice ] += 1;
-
-  if( local_entries[ choice ] <= 0 ) {
-    /* Overflow! */
+  if( local_entries[ choice ] == std::numeric_limits<T>::max( ) ) {
+    /* Incrementing would overflow, so leave the entry saturated */
+    __sync_fetch_and_add( &num_dropped, 1 );
     return 1;
   }
+  local_entries[ choice ] += 1;
 
   return 0;
 }
@@ -266,6 +307,8 @@ pure_cfr_entry_type_t Entries_der<T>::get_entry_type( ) const
     return TYPE_UINT32_T;
   } else if( typeid( T ) == typeid( uint64_t ) ) {
     return TYPE_UINT64_T;
+  } else if( typeid( T ) == typeid( int64_t ) ) {
+    return TYPE_INT64_T;
   } else {
     fprintf( stderr, "called get_entry_type for unrecognized template type!\n" );
     assert( 0 );
@@ -273,6 +316,29 @@ pure_cfr_entry_type_t Entries_der<T>::get_entry_type( ) const
   }
 }
 
+template <typename T>
+void Entries_der<T>::get_saturation( const size_t begin,
+				     const size_t end,
+				     saturation_t &sat ) const
+{
+  /* Number of bits available to the magnitude of a value */
+  const int value_bits = std::numeric_limits<T>::digits;
+
+  for( size_t i = begin; i < end; ++i ) {
+    const T value = entries[ i ];
+    const uint64_t abs_value = ( value < 0 ? -( int64_t ) value : value );
+    if( abs_value > sat.max_abs_value ) {
+      sat.max_abs_value = abs_value;
+    }
+    int used_bits = ( abs_value == 0 ? 0 : 64 - __builtin_clzll( abs_value ) );
+    int headroom = value_bits - used_bits;
+    if( headroom >= NUM_SATURATION_BINS ) {
+      headroom = NUM_SATURATION_BINS - 1;
+    }
+    sat.histogram[ headroom ] += 1;
+  }
+}
+
 template <typename T>
 void Entries_der<T>::get_values( const int bucket,
 				 const int64_t soln_idx,
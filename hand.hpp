@@ -28,14 +28,26 @@ typedef struct {
    * we just compute the buckets once and store
    */
   int precomputed_buckets[ MAX_PURE_CFR_PLAYERS ][ MAX_ROUNDS ];
+  /* Bit player * MAX_ROUNDS + round is set once
+   * precomputed_buckets[ player ][ round ] holds that bucket.  Buckets that
+   * cannot be precomputed are filled in the first time they are needed.
+   */
+  uint32_t known_buckets;
   union {
-    /* Potsize divided by pot_frac_recip[ p ][ type ] = utilily for player p
-     * (>2p only)
+    /* Players sorted from best hand to worst, and each player's strength,
+     * where 0 is the best hand and tied players share a strength.  The pot
+     * goes to the players not folded with the best strength (>2p only).
      */
-    int pot_frac_recip[ MAX_PURE_CFR_PLAYERS ][ LEAF_NUM_TYPES ];
+    struct {
+      int8_t order[ MAX_PURE_CFR_PLAYERS ];
+      int8_t strength[ MAX_PURE_CFR_PLAYERS ];
+    } showdown_np;
     /* (-1,0,1) if player (loses,ties,wins) in showdown (2p only)*/
     int8_t showdown_value_2p[ 2 ]; 
   } eval;
 } hand_t;
 
+static_assert( MAX_PURE_CFR_PLAYERS * MAX_ROUNDS <= 32,
+	       "known_buckets needs a bit for every player and round" );
+
 #endif
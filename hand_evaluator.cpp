@@ -0,0 +1,157 @@
+/* hand_evaluator.cpp
+ * Ranks every player's hand at showdown with a few table reads.
+ */
+
+/* C / C++ / STL includes */
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <vector>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/evalHandTables"
+}
+
+/* Pure CFR includes */
+#include "hand_evaluator.hpp"
+
+/* The best non-flush value of a multiset of ranks keyed by its count of each
+ * rank in base 5.  This is rankCardset on its cards with the suits dealt out
+ * in turn, which never makes a flush with this few cards.
+ */
+static int multiset_value( uint64_t key )
+{
+  Cardset cards = emptyCardset( );
+  int num_dealt = 0;
+  for( int r = 0; r < MAX_RANKS; ++r, key /= 5 ) {
+    for( int i = 0; i < ( int ) ( key % 5 ); ++i ) {
+      addCardToCardset( &cards, num_dealt % MAX_SUITS, r );
+      ++num_dealt;
+    }
+  }
+  return rankCardset( cards );
+}
+
+HandEvaluator::HandEvaluator( const Game *game )
+  : num_players( game->numPlayers ),
+    num_hole_cards( game->numHoleCards ),
+    num_board_cards( sumBoardCards( game, game->numRounds - 1 ) ),
+    next_state( NULL )
+{
+  const int num_cards = num_hole_cards + num_board_cards;
+  if( ( num_cards > MAX_EVALUATOR_CARDS )
+      || ( ( num_hole_cards == 1 ) && ( num_board_cards == 0 ) ) ) {
+    /* Too many cards, or rankHand's special one card ranker for Kuhn */
+    return;
+  }
+
+  /* Number the multisets of ranks one layer of cards at a time.  A multiset
+   * is keyed by its count of each rank in base 5.  The last card's
+   * transition gives the value of the full hand rather than a multiset.
+   */
+  std::map<uint64_t, uint16_t> ids;
+  std::vector<uint64_t> keys( 1, 0 );
+  std::vector<uint16_t> next;
+  ids[ 0 ] = 0;
+  size_t layer_start = 0;
+  for( int k = 0; k < num_cards; ++k ) {
+    const size_t layer_end = keys.size( );
+    for( size_t s = layer_start; s < layer_end; ++s ) {
+      uint64_t place = 1;
+      for( int r = 0; r < MAX_RANKS; ++r, place *= 5 ) {
+	const int count = ( keys[ s ] / place ) % 5;
+	if( ( r >= game->numRanks ) || ( count >= game->numSuits ) ) {
+	  /* No such card can be dealt */
+	  next.push_back( 0 );
+	  continue;
+	}
+	const uint64_t key = keys[ s ] + place;
+	if( k == num_cards - 1 ) {
+	  next.push_back( multiset_value( key ) );
+	  continue;
+	}
+	std::map<uint64_t, uint16_t>::iterator it = ids.find( key );
+	if( it == ids.end( ) ) {
+	  if( keys.size( ) > UINT16_MAX ) {
+	    /* Cannot happen with MAX_EVALUATOR_CARDS cards of MAX_RANKS ranks */
+	    fprintf( stderr, "WARNING: too many rank multisets for the hand "
+		     "evaluator, ranking hands without the tables\n" );
+	    return;
+	  }
+	  it = ids.insert( std::make_pair( key, ( uint16_t ) keys.size( ) ) ).first;
+	  keys.push_back( key );
+	}
+	next.push_back( it->second );
+      }
+    }
+    layer_start = layer_end;
+  }
+
+  next_state = new uint16_t[ next.size( ) ];
+  for( size_t i = 0; i < next.size( ); ++i ) {
+    next_state[ i ] = next[ i ];
+  }
+}
+
+HandEvaluator::~HandEvaluator( )
+{
+  delete [] next_state;
+}
+
+void HandEvaluator::rank_hands( const hand_t &hand, int *ranks ) const
+{
+  if( next_state == NULL ) {
+    for( int p = 0; p < num_players; ++p ) {
+      if( ( num_hole_cards == 1 ) && ( num_board_cards == 0 ) ) {
+	/* rankHand's special one card ranker for Kuhn */
+	ranks[ p ] = rankOfCard( hand.hole_cards[ p ][ 0 ] );
+	continue;
+      }
+      Cardset cards = emptyCardset( );
+      for( int i = 0; i < num_hole_cards; ++i ) {
+	addCardToCardset( &cards, suitOfCard( hand.hole_cards[ p ][ i ] ),
+			  rankOfCard( hand.hole_cards[ p ][ i ] ) );
+      }
+      for( int i = 0; i < num_board_cards; ++i ) {
+	addCardToCardset( &cards, suitOfCard( hand.board_cards[ i ] ),
+			  rankOfCard( hand.board_cards[ i ] ) );
+      }
+      ranks[ p ] = rankCardset( cards );
+    }
+    return;
+  }
+
+  /* The board is shared, so walk it once */
+  int board_state = 0;
+  uint16_t board_suits[ MAX_SUITS ] = { 0 };
+  for( int i = 0; i < num_board_cards; ++i ) {
+    const int rank = rankOfCard( hand.board_cards[ i ] );
+    board_state = next_state[ board_state * MAX_RANKS + rank ];
+    board_suits[ suitOfCard( hand.board_cards[ i ] ) ] |= 1 << rank;
+  }
+
+  for( int p = 0; p < num_players; ++p ) {
+    int state = board_state;
+    uint16_t suits[ MAX_SUITS ];
+    for( int s = 0; s < MAX_SUITS; ++s ) {
+      suits[ s ] = board_suits[ s ];
+    }
+    for( int i = 0; i < num_hole_cards; ++i ) {
+      const int rank = rankOfCard( hand.hole_cards[ p ][ i ] );
+      state = next_state[ state * MAX_RANKS + rank ];
+      suits[ suitOfCard( hand.hole_cards[ p ][ i ] ) ] |= 1 << rank;
+    }
+
+    /* The walk ends on the non-flush value.  oneSuitVal is zero for fewer
+     * than five cards of a suit.
+     */
+    int value = state;
+    for( int s = 0; s < MAX_SUITS; ++s ) {
+      if( oneSuitVal[ suits[ s ] ] > value ) {
+	value = oneSuitVal[ suits[ s ] ];
+      }
+    }
+    ranks[ p ] = value;
+  }
+}
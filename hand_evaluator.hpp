@@ -0,0 +1,63 @@
+#ifndef __PURE_CFR_HAND_EVALUATOR_HPP__
+#define __PURE_CFR_HAND_EVALUATOR_HPP__
+
+/* hand_evaluator.hpp
+ * Ranks every player's hand at showdown with a few table reads, giving the
+ * same ranks as rankHand in the ACPC server code.
+ *
+ * A hand's best non-flush value depends only on the multiset of its ranks,
+ * so the multisets are numbered and a transition table gives the multiset
+ * reached by adding one more card of a given rank, with the last card giving
+ * the value instead.  The board's multiset is found once per hand, then each
+ * player's value takes one read per hole card.  A flush or straight flush
+ * depends only on the ranks held in one suit, which is exactly what the ACPC
+ * oneSuitVal table is indexed by, so the rank of a hand is the larger of its
+ * multiset value and the oneSuitVal of each of its suits.
+ */
+
+/* C / C++ / STL includes */
+#include <stdint.h>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/game.h"
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "hand.hpp"
+
+/* Most cards in a hand at showdown the tables are built for */
+const int MAX_EVALUATOR_CARDS = 7;
+
+class HandEvaluator {
+public:
+
+  HandEvaluator( const Game *game );
+  ~HandEvaluator( );
+
+  /* Returns false if the tables are not used, such as when there are more
+   * than MAX_EVALUATOR_CARDS cards at showdown
+   */
+  bool is_supported( ) const { return next_state != NULL; }
+
+  /* Sets ranks[ p ] to what rankHand would give for each player p of the
+   * game at showdown.  Without the tables, this ranks each player's cards
+   * as rankHand does, but straight from the card arrays.
+   */
+  void rank_hands( const hand_t &hand, int *ranks ) const;
+
+protected:
+  int num_players;
+  int num_hole_cards;
+  int num_board_cards;
+  /* next_state[ s * MAX_RANKS + r ] is the multiset reached by adding a card
+   * of rank r to multiset s, or the best non-flush value of the hand if that
+   * card completes it.  Below MAX_EVALUATOR_CARDS cards there are few enough
+   * multisets to number in 16 bits, keeping the table small enough to stay
+   * in cache.
+   */
+  uint16_t *next_state;
+};
+
+#endif
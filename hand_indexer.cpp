@@ -0,0 +1,416 @@
+/* hand_indexer.cpp
+ * Numbers the hands a player can see in each round up to suit isomorphism.
+ */
+
+/* C / C++ / STL includes */
+#include <set>
+
+/* Pure CFR includes */
+#include "hand_indexer.hpp"
+
+/* Bits used by one suit's counts in a config_t */
+static const int SUIT_COUNTS_BITS = 4 * MAX_INDEXER_GROUPS;
+
+/* n choose k for small k, exact as long as the result fits */
+static int64_t choose( const int64_t n, const int k )
+{
+  if( k > n ) {
+    return 0;
+  }
+  int64_t result = 1;
+  for( int i = 0; i < k; ++i ) {
+    result = result * ( n - i ) / ( i + 1 );
+  }
+  return result;
+}
+
+/* Hashes a configuration to a slot of a table of mask + 1 slots */
+static inline size_t config_hash( const __uint128_t config, const size_t mask )
+{
+  const uint64_t folded = ( uint64_t ) config ^ ( uint64_t ) ( config >> 64 );
+  return ( ( folded * 0x9e3779b97f4a7c15ULL ) >> 32 ) & mask;
+}
+
+/* n choose k for k at most MAX_SUITS, dividing by constants so that the
+ * compiler can avoid a division instruction
+ */
+static inline int64_t choose_few( const int64_t n, const int k )
+{
+  switch( k ) {
+  case 1:
+    return n;
+  case 2:
+    return n * ( n - 1 ) / 2;
+  case 3:
+    return n * ( n - 1 ) * ( n - 2 ) / 6;
+  default:
+    return n * ( n - 1 ) * ( n - 2 ) * ( n - 3 ) / 24;
+  }
+}
+
+/* Adds every configuration reachable by dealing the rest of group g, from
+ * suit s on, with left cards of the group still to deal
+ */
+static void add_configs( const int num_suits, const int num_ranks,
+			 const int num_groups, const int *group_size,
+			 const int g, const int s, const int left,
+			 uint32_t *counts, int *totals,
+			 std::set<__uint128_t> &configs )
+{
+  if( g == num_groups ) {
+    uint32_t sorted[ MAX_SUITS ];
+    for( int i = 0; i < num_suits; ++i ) {
+      int j = i;
+      while( ( j > 0 ) && ( sorted[ j - 1 ] < counts[ i ] ) ) {
+	sorted[ j ] = sorted[ j - 1 ];
+	--j;
+      }
+      sorted[ j ] = counts[ i ];
+    }
+    __uint128_t config = 0;
+    for( int i = 0; i < num_suits; ++i ) {
+      config = ( config << SUIT_COUNTS_BITS ) | sorted[ i ];
+    }
+    configs.insert( config );
+    return;
+  }
+  if( s == num_suits - 1 ) {
+    /* The last suit takes whatever is left of the group */
+    if( totals[ s ] + left > num_ranks ) {
+      return;
+    }
+    counts[ s ] |= ( uint32_t ) left << ( 4 * g );
+    totals[ s ] += left;
+    add_configs( num_suits, num_ranks, num_groups, group_size, g + 1, 0,
+		 ( g + 1 < num_groups ? group_size[ g + 1 ] : 0 ),
+		 counts, totals, configs );
+    totals[ s ] -= left;
+    counts[ s ] &= ~( ( uint32_t ) 0xf << ( 4 * g ) );
+    return;
+  }
+  for( int c = 0; ( c <= left ) && ( totals[ s ] + c <= num_ranks ); ++c ) {
+    counts[ s ] |= ( uint32_t ) c << ( 4 * g );
+    totals[ s ] += c;
+    add_configs( num_suits, num_ranks, num_groups, group_size, g, s + 1,
+		 left - c, counts, totals, configs );
+    totals[ s ] -= c;
+    counts[ s ] &= ~( ( uint32_t ) 0xf << ( 4 * g ) );
+  }
+}
+
+HandIndexer::HandIndexer( const Game *game )
+  : num_suits( game->numSuits ),
+    num_ranks( game->numRanks ),
+    num_rounds( game->numRounds ),
+    num_hole_cards( game->numHoleCards )
+{
+  for( int n = 0; n <= MAX_RANKS; ++n ) {
+    for( int k = 0; k <= MAX_RANKS; ++k ) {
+      nck[ n ][ k ] = choose( n, k );
+    }
+  }
+  for( int set = 0; set < ( 1 << MAX_RANKS ); ++set ) {
+    num_ranks_in[ set ] = __builtin_popcount( set );
+  }
+
+  /* The hole cards, then each round's board cards, are a group */
+  int groups = 1;
+  group_start[ 0 ] = 0;
+  group_size[ 0 ] = num_hole_cards;
+  for( int r = 0; r < num_rounds; ++r ) {
+    if( game->numBoardCards[ r ] > 0 ) {
+      group_start[ groups ] = bcStart( game, r );
+      group_size[ groups ] = game->numBoardCards[ r ];
+      ++groups;
+    }
+    num_groups[ r ] = groups;
+  }
+
+  for( int r = 0; r < num_rounds; ++r ) {
+    std::set<__uint128_t> round_configs;
+    uint32_t counts[ MAX_SUITS ] = { 0 };
+    int totals[ MAX_SUITS ] = { 0 };
+    add_configs( num_suits, num_ranks, num_groups[ r ], group_size, 0, 0,
+		 group_size[ 0 ], counts, totals, round_configs );
+    configs[ r ].assign( round_configs.begin( ), round_configs.end( ) );
+    size_t num_slots = 1;
+    while( num_slots < 2 * configs[ r ].size( ) ) {
+      num_slots *= 2;
+    }
+    config_slots[ r ].assign( num_slots, -1 );
+    for( size_t i = 0; i < configs[ r ].size( ); ++i ) {
+      size_t slot = config_hash( configs[ r ][ i ], num_slots - 1 );
+      while( config_slots[ r ][ slot ] >= 0 ) {
+	slot = ( slot + 1 ) & ( num_slots - 1 );
+      }
+      config_slots[ r ][ slot ] = i;
+    }
+
+    config_info[ r ].resize( configs[ r ].size( ) );
+    size[ r ] = 0;
+    for( size_t i = 0; i < configs[ r ].size( ); ++i ) {
+      config_info[ r ][ i ].offset = size[ r ];
+      size[ r ] += config_size( configs[ r ][ i ], num_groups[ r ],
+				config_info[ r ][ i ] );
+    }
+  }
+}
+
+HandIndexer::~HandIndexer( )
+{
+}
+
+int64_t HandIndexer::suit_set_size( const suit_counts_t counts,
+				    const int num_groups ) const
+{
+  int64_t result = 1;
+  int used = 0;
+  for( int g = 0; g < num_groups; ++g ) {
+    const int c = ( counts >> ( 4 * g ) ) & 0xf;
+    result *= nck[ num_ranks - used ][ c ];
+    used += c;
+  }
+  return result;
+}
+
+int64_t HandIndexer::config_size( const config_t config,
+				  const int num_groups,
+				  config_info_t &info ) const
+{
+  /* Suits with the same counts are a multiset of their rank sets.  Later
+   * runs are the less significant digits of the index.
+   */
+  int64_t result = 1;
+  int run_start[ MAX_SUITS ];
+  int64_t run_size[ MAX_SUITS ];
+  int num_runs = 0;
+  int i = 0;
+  while( i < num_suits ) {
+    const suit_counts_t counts
+      = ( config >> ( SUIT_COUNTS_BITS * ( num_suits - 1 - i ) ) )
+      & ( ( 1 << SUIT_COUNTS_BITS ) - 1 );
+    int j = i + 1;
+    while( ( j < num_suits )
+	   && ( ( ( config >> ( SUIT_COUNTS_BITS * ( num_suits - 1 - j ) ) )
+		  & ( ( 1 << SUIT_COUNTS_BITS ) - 1 ) ) == counts ) ) {
+      ++j;
+    }
+    run_start[ num_runs ] = i;
+    run_size[ num_runs ]
+      = choose( suit_set_size( counts, num_groups ) + j - i - 1, j - i );
+    ++num_runs;
+    i = j;
+  }
+  for( int s = 0; s < MAX_SUITS; ++s ) {
+    info.multiplier[ s ] = 0;
+  }
+  for( int run = num_runs - 1; run >= 0; --run ) {
+    info.multiplier[ run_start[ run ] ] = result;
+    result *= run_size[ run ];
+  }
+  return result;
+}
+
+int HandIndexer::index_hand( const uint8_t *hole_cards,
+			     const uint8_t *board_cards,
+			     const int last_round,
+			     int64_t *indices ) const
+{
+  /* Each suit's ranks so far, rank sets indexed so far, and counts */
+  uint16_t used[ MAX_SUITS ] = { 0 };
+  int64_t suit_index[ MAX_SUITS ] = { 0 };
+  suit_counts_t counts[ MAX_SUITS ] = { 0 };
+
+  int g = 0;
+  for( int r = 0; r <= last_round; ++r ) {
+    for( ; g < num_groups[ r ]; ++g ) {
+      const uint8_t *cards = ( g == 0 ? hole_cards
+			       : &board_cards[ group_start[ g ] ] );
+      uint16_t ranks[ MAX_SUITS ] = { 0 };
+      for( int i = 0; i < group_size[ g ]; ++i ) {
+	if( ( rankOfCard( cards[ i ] ) >= num_ranks )
+	    || ( suitOfCard( cards[ i ] ) >= num_suits ) ) {
+	  return 1;
+	}
+	const uint16_t bit = 1 << rankOfCard( cards[ i ] );
+	const int suit = suitOfCard( cards[ i ] );
+	if( ( ranks[ suit ] | used[ suit ] ) & bit ) {
+	  /* Dealt twice */
+	  return 1;
+	}
+	ranks[ suit ] |= bit;
+      }
+
+      /* Index each suit's new rank set among the subsets of the ranks it
+       * has not used yet, in colex order
+       */
+      for( int s = 0; s < num_suits; ++s ) {
+	const int num_used = num_ranks_in[ used[ s ] ];
+	int64_t set_index = 0;
+	int k = 0;
+	for( uint16_t m = ranks[ s ]; m != 0; m &= m - 1 ) {
+	  const int rank = __builtin_ctz( m );
+	  ++k;
+	  set_index
+	    += nck[ rank - num_ranks_in[ used[ s ] & ( ( 1 << rank ) - 1 ) ] ][ k ];
+	}
+	suit_index[ s ] = suit_index[ s ] * nck[ num_ranks - num_used ][ k ]
+	  + set_index;
+	counts[ s ] |= ( suit_counts_t ) k << ( 4 * g );
+	used[ s ] |= ranks[ s ];
+      }
+    }
+
+    /* Sort the suits into canonical order, largest counts first */
+    int order[ MAX_SUITS ];
+    for( int s = 0; s < num_suits; ++s ) {
+      int i = s;
+      while( ( i > 0 )
+	     && ( ( counts[ order[ i - 1 ] ] < counts[ s ] )
+		  || ( ( counts[ order[ i - 1 ] ] == counts[ s ] )
+		       && ( suit_index[ order[ i - 1 ] ] < suit_index[ s ] ) ) ) ) {
+	order[ i ] = order[ i - 1 ];
+	--i;
+      }
+      order[ i ] = s;
+    }
+    config_t config = 0;
+    for( int i = 0; i < num_suits; ++i ) {
+      config = ( config << SUIT_COUNTS_BITS ) | counts[ order[ i ] ];
+    }
+    const size_t mask = config_slots[ r ].size( ) - 1;
+    size_t slot = config_hash( config, mask );
+    /* Configurations not in the table come from impossible hands */
+    while( ( config_slots[ r ][ slot ] != -1 )
+	   && ( configs[ r ][ config_slots[ r ][ slot ] ] != config ) ) {
+      slot = ( slot + 1 ) & mask;
+    }
+    const int config_id = config_slots[ r ][ slot ];
+    if( config_id == -1 ) {
+      return 1;
+    }
+
+    const config_info_t &info = config_info[ r ][ config_id ];
+
+    /* Index each run of suits with the same counts as a multiset */
+    int64_t index = info.offset;
+    int i = 0;
+    while( i < num_suits ) {
+      int j = i + 1;
+      while( ( j < num_suits ) && ( counts[ order[ j ] ] == counts[ order[ i ] ] ) ) {
+	++j;
+      }
+      const int run = j - i;
+      int64_t multiset_index = 0;
+      for( int k = 0; k < run; ++k ) {
+	multiset_index += choose_few( suit_index[ order[ i + k ] ] + run - 1 - k,
+				      run - k );
+      }
+      index += multiset_index * info.multiplier[ i ];
+      i = j;
+    }
+    indices[ r ] = index;
+  }
+
+  return 0;
+}
+
+void HandIndexer::unindex_hand( const int round, const int64_t index,
+				uint8_t *hole_cards, uint8_t *board_cards ) const
+{
+  /* Find the configuration, the last to start at or before index */
+  size_t lo = 0;
+  size_t hi = config_info[ round ].size( );
+  while( hi - lo > 1 ) {
+    const size_t mid = ( lo + hi ) / 2;
+    if( config_info[ round ][ mid ].offset <= index ) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  const config_info_t &info = config_info[ round ][ lo ];
+  suit_counts_t counts[ MAX_SUITS ];
+  for( int s = 0; s < num_suits; ++s ) {
+    counts[ s ] = ( configs[ round ][ lo ] >> ( SUIT_COUNTS_BITS
+						* ( num_suits - 1 - s ) ) )
+      & ( ( 1 << SUIT_COUNTS_BITS ) - 1 );
+  }
+
+  /* Split the index into each run's multiset, and each multiset into its
+   * suits' indices, largest first
+   */
+  int64_t left = index - info.offset;
+  int64_t suit_index[ MAX_SUITS ];
+  int i = 0;
+  while( i < num_suits ) {
+    int j = i + 1;
+    while( ( j < num_suits ) && ( counts[ j ] == counts[ i ] ) ) {
+      ++j;
+    }
+    const int run = j - i;
+    int64_t multiset_index = left / info.multiplier[ i ];
+    left %= info.multiplier[ i ];
+    const int64_t set_size = suit_set_size( counts[ i ], num_groups[ round ] );
+    for( int k = 0; k < run; ++k ) {
+      /* Largest b with choose_few( b, run - k ) <= multiset_index */
+      int64_t b_lo = run - 1 - k;
+      int64_t b_hi = set_size + run - 1 - k;
+      while( b_hi - b_lo > 1 ) {
+	const int64_t mid = ( b_lo + b_hi ) / 2;
+	if( choose_few( mid, run - k ) <= multiset_index ) {
+	  b_lo = mid;
+	} else {
+	  b_hi = mid;
+	}
+      }
+      multiset_index -= choose_few( b_lo, run - k );
+      suit_index[ i + k ] = b_lo - ( run - 1 - k );
+    }
+    i = j;
+  }
+
+  /* Deal each suit's rank sets, giving the suits in sorted order */
+  int dealt[ MAX_INDEXER_GROUPS ] = { 0 };
+  for( int s = 0; s < num_suits; ++s ) {
+    int set_index[ MAX_INDEXER_GROUPS ];
+    int available[ MAX_INDEXER_GROUPS ];
+    int num_used = 0;
+    for( int g = 0; g < num_groups[ round ]; ++g ) {
+      available[ g ] = num_ranks - num_used;
+      num_used += ( counts[ s ] >> ( 4 * g ) ) & 0xf;
+    }
+    for( int g = num_groups[ round ] - 1; g >= 0; --g ) {
+      const int radix = nck[ available[ g ] ][ ( counts[ s ] >> ( 4 * g ) ) & 0xf ];
+      set_index[ g ] = suit_index[ s ] % radix;
+      suit_index[ s ] /= radix;
+    }
+
+    uint16_t used = 0;
+    for( int g = 0; g < num_groups[ round ]; ++g ) {
+      uint8_t *cards = ( g == 0 ? hole_cards : &board_cards[ group_start[ g ] ] );
+      uint16_t ranks = 0;
+      int remaining = set_index[ g ];
+      for( int k = ( counts[ s ] >> ( 4 * g ) ) & 0xf; k > 0; --k ) {
+	/* Largest compressed rank x with nck[ x ][ k ] <= remaining, then the
+	 * x-th rank this suit has not used
+	 */
+	int x = k - 1;
+	while( nck[ x + 1 ][ k ] <= remaining ) {
+	  ++x;
+	}
+	remaining -= nck[ x ][ k ];
+	int rank = -1;
+	for( int unused = -1; unused < x; ) {
+	  ++rank;
+	  if( !( used & ( 1 << rank ) ) ) {
+	    ++unused;
+	  }
+	}
+	ranks |= 1 << rank;
+	cards[ dealt[ g ]++ ] = makeCard( rank, s );
+      }
+      used |= ranks;
+    }
+  }
+}
@@ -0,0 +1,101 @@
+#ifndef __PURE_CFR_HAND_INDEXER_HPP__
+#define __PURE_CFR_HAND_INDEXER_HPP__
+
+/* hand_indexer.hpp
+ * Numbers the hands a player can see in each round, counting hands that only
+ * differ by a relabelling of the suits, or by the order of the cards dealt
+ * in one round, as the same hand.  Every index below get_size( round ) is
+ * used by exactly one such class of hands.
+ *
+ * The cards are split into groups: the hole cards, then the board cards
+ * dealt in each round.  A suit is described by the set of ranks it has in
+ * each group, and a hand by the multiset of its suits' descriptions.  Hands
+ * are first split by the number of cards each suit has in each group, the
+ * hand's configuration, and then numbered within it by indexing each suit's
+ * rank sets and combining suits with the same counts as a multiset.
+ */
+
+/* C / C++ / STL includes */
+#include <stdint.h>
+#include <vector>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/game.h"
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+
+/* Most groups of cards a hand is split into: the hole cards, then the board
+ * cards of each round
+ */
+const int MAX_INDEXER_GROUPS = MAX_ROUNDS + 1;
+
+class HandIndexer {
+public:
+
+  HandIndexer( const Game *game );
+  ~HandIndexer( );
+
+  /* Number of distinct hands a player can see in round */
+  int64_t get_size( const int round ) const { return size[ round ]; }
+
+  /* Sets indices[ r ] to the index of the hand made of hole_cards and the
+   * board cards dealt by round r, for every round r up to and including
+   * last_round.  Board cards dealt after last_round are not read.  Returns 0
+   * on success, or 1 if the cards are not a possible hand (such as when two
+   * are the same), in which case indices are only set for the rounds before
+   * the first round they fail in.
+   */
+  int index_hand( const uint8_t *hole_cards, const uint8_t *board_cards,
+		  const int last_round, int64_t *indices ) const;
+
+  /* Sets hole_cards, and the board cards dealt by round, to one of the hands
+   * with the given index in round
+   */
+  void unindex_hand( const int round, const int64_t index,
+		     uint8_t *hole_cards, uint8_t *board_cards ) const;
+
+protected:
+  /* A suit's card count in each group so far, four bits per group */
+  typedef uint32_t suit_counts_t;
+  /* The suit_counts_t of every suit, largest first */
+  typedef __uint128_t config_t;
+  /* Where a configuration's hands start, and the weight of the multiset
+   * index of each run of suits with equal counts, by the run's first suit
+   */
+  typedef struct {
+    int64_t offset;
+    int64_t multiplier[ MAX_SUITS ];
+  } config_info_t;
+
+  int64_t suit_set_size( const suit_counts_t counts, const int num_groups ) const;
+  /* Sets info's multipliers and returns the number of hands in config */
+  int64_t config_size( const config_t config, const int num_groups,
+		       config_info_t &info ) const;
+
+  int num_suits;
+  int num_ranks;
+  int num_rounds;
+  int num_hole_cards;
+  /* Groups and board cards seen by the end of each round, skipping rounds
+   * that deal no board cards
+   */
+  int num_groups[ MAX_ROUNDS ];
+  int group_start[ MAX_INDEXER_GROUPS ];
+  int group_size[ MAX_INDEXER_GROUPS ];
+  int64_t size[ MAX_ROUNDS ];
+  /* Every configuration of each round in sorted order */
+  std::vector<config_t> configs[ MAX_ROUNDS ];
+  std::vector<config_info_t> config_info[ MAX_ROUNDS ];
+  /* Open addressed hash of each round's configurations to their position in
+   * configs, a power of two in size with at least half its slots empty
+   */
+  std::vector<int> config_slots[ MAX_ROUNDS ];
+  int nck[ MAX_RANKS + 1 ][ MAX_RANKS + 1 ];
+  /* Number of ranks in each set of ranks */
+  uint8_t num_ranks_in[ 1 << MAX_RANKS ];
+};
+
+#endif
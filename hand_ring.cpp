@@ -0,0 +1,24 @@
+/* hand_ring.cpp
+ * Lock-free single-producer, single-consumer ring of ready-to-walk hands.
+ */
+
+/* C / C++ / STL includes */
+#include <stdlib.h>
+
+/* Pure CFR includes */
+#include "hand_ring.hpp"
+
+int init_hand_ring( hand_ring_t &ring, const int depth )
+{
+  ring.head = 0;
+  ring.tail = 0;
+  ring.depth = depth;
+  ring.hands = ( hand_t * ) malloc( depth * sizeof( hand_t ) );
+  return ( ring.hands == NULL );
+}
+
+void free_hand_ring( hand_ring_t &ring )
+{
+  free( ring.hands );
+  ring.hands = NULL;
+}
@@ -0,0 +1,61 @@
+#ifndef __PURE_CFR_HAND_RING_HPP__
+#define __PURE_CFR_HAND_RING_HPP__
+
+/* hand_ring.hpp
+ * Lock-free single-producer, single-consumer ring of ready-to-walk hands.
+ * A producer thread deals and evaluates hands into the ring while a worker
+ * thread takes them out, so the worker spends its time walking the tree.
+ */
+
+/* C / C++ / STL includes */
+#include <stdint.h>
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "hand.hpp"
+
+typedef struct {
+  /* The consumer and producer each write their own cache line */
+  alignas( CACHE_LINE_SIZE ) uint64_t head; /* next hand to take */
+  alignas( CACHE_LINE_SIZE ) uint64_t tail; /* next free slot */
+  alignas( CACHE_LINE_SIZE ) hand_t *hands;
+  int depth;
+} hand_ring_t;
+
+/* Returns 0 on success, 1 on failure */
+int init_hand_ring( hand_ring_t &ring, const int depth );
+void free_hand_ring( hand_ring_t &ring );
+
+/* Producer only.  Returns the slot the next hand should be written to, or
+ * NULL if the ring is full.  The hand is handed over by push_hand_ring.
+ */
+static inline hand_t *reserve_hand_ring( hand_ring_t &ring )
+{
+  const uint64_t tail = ring.tail;
+  if( tail - __atomic_load_n( &ring.head, __ATOMIC_ACQUIRE )
+      >= ( uint64_t ) ring.depth ) {
+    return NULL;
+  }
+  return &ring.hands[ tail % ring.depth ];
+}
+
+static inline void push_hand_ring( hand_ring_t &ring )
+{
+  __atomic_store_n( &ring.tail, ring.tail + 1, __ATOMIC_RELEASE );
+}
+
+/* Consumer only.  Copies the oldest hand into hand and returns true, or
+ * returns false if the ring is empty.
+ */
+static inline bool pop_hand_ring( hand_ring_t &ring, hand_t &hand )
+{
+  const uint64_t head = ring.head;
+  if( head == __atomic_load_n( &ring.tail, __ATOMIC_ACQUIRE ) ) {
+    return false;
+  }
+  hand = ring.hands[ head % ring.depth ];
+  __atomic_store_n( &ring.head, head + 1, __ATOMIC_RELEASE );
+  return true;
+}
+
+#endif
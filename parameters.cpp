@@ -22,24 +22,150 @@ Parameters::Parameters( )
   /* Set optional parameters to defaults */
   load_dump = false;
   card_abs_type = CARD_ABS_NULL;
+  bucket_file[ 0 ] = '\0';
   action_abs_type = ACTION_ABS_NULL;
+  action_file[ 0 ] = '\0';
   rng_seeds[ 0 ] = 6;
   rng_seeds[ 1 ] = 12;
   rng_seeds[ 2 ] = 1983;
   rng_seeds[ 3 ] = 28;
+  rng_type = RNG_MT;
   num_threads = 1;
+  thread_control = false;
+  affinity_type = AFFINITY_NONE;
+  num_affinity_cpus = 0;
   status_freq_seconds = 60;
   dump_timer.seconds_start = INT_MAX;
   dump_timer.seconds_mult = 1;
   dump_timer.seconds_add = 0;
+  checkpoint_mode = CHECKPOINT_BLOCKING;
+  chance_sampling = CHANCE_SAMPLING_UNIFORM;
+  hand_batch = 1;
+  hand_producers = 0;
+  hand_ring_depth = 64;
+  max_table_deals = 0;
   max_walltime_seconds = INT_MAX;
+  max_iterations = INT64_MAX;
+  deterministic = false;
   do_average = true;
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    regret_types[ r ] = REGRET_TYPES[ r ];
+    avg_strategy_types[ r ] = AVG_STRATEGY_TYPES[ r ];
+  }
+  plan_only = false;
 }
 
 Parameters::~Parameters( )
 {
 }
 
+/* Parses a placement policy name or a list of CPUs such as 0,2,4-7.
+ * Returns 0 on success, 1 on failure.
+ */
+static int parse_affinity( const char *str,
+			   affinity_type_t &type,
+			   int cpus[ MAX_AFFINITY_CPUS ],
+			   int &num_cpus )
+{
+  for( int i = 0; i < NUM_AFFINITY_TYPES; ++i ) {
+    if( ( i != AFFINITY_LIST ) && !strcmp( str, affinity_type_to_str[ i ] ) ) {
+      type = ( affinity_type_t ) i;
+      return 0;
+    }
+  }
+
+  num_cpus = 0;
+  const char *ptr = str;
+  while( ptr[ 0 ] != '\0' ) {
+    int first, last, len;
+    if( sscanf( ptr, "%d-%d%n", &first, &last, &len ) < 2 ) {
+      if( sscanf( ptr, "%d%n", &first, &len ) < 1 ) {
+	fprintf( stderr, "Could not parse affinity from [%s]\n", str );
+	return 1;
+      }
+      last = first;
+    }
+    if( ( first < 0 ) || ( last < first ) ) {
+      fprintf( stderr, "Bad CPU range in affinity [%s]\n", str );
+      return 1;
+    }
+    for( int c = first; c <= last; ++c ) {
+      if( num_cpus >= MAX_AFFINITY_CPUS ) {
+	fprintf( stderr, "Too many CPUs in affinity [%s]\n", str );
+	return 1;
+      }
+      cpus[ num_cpus ] = c;
+      ++num_cpus;
+    }
+    ptr += len;
+    if( ptr[ 0 ] == ',' ) {
+      ++ptr;
+    } else if( ptr[ 0 ] != '\0' ) {
+      fprintf( stderr, "Could not parse affinity from [%s]\n", str );
+      return 1;
+    }
+  }
+  if( num_cpus == 0 ) {
+    fprintf( stderr, "No CPUs listed in affinity [%s]\n", str );
+    return 1;
+  }
+  type = AFFINITY_LIST;
+
+  return 0;
+}
+
+/* Parses a list of entry types separated by commas or whitespace, one per
+ * round.  If fewer than MAX_ROUNDS types are listed, the last type is used
+ * for all remaining rounds.  Returns 0 on success, 1 on failure.
+ */
+static int parse_entry_types( const char *str,
+			      pure_cfr_entry_type_t types[ MAX_ROUNDS ] )
+{
+  int r = 0;
+  const char *ptr = str;
+  while( r < MAX_ROUNDS ) {
+    /* Skip separators */
+    while( isspace( ptr[ 0 ] ) || ( ptr[ 0 ] == ',' ) || ( ptr[ 0 ] == '=' ) ) {
+      ++ptr;
+    }
+    if( ptr[ 0 ] == '\0' ) {
+      break;
+    }
+
+    /* Find the end of this type */
+    int len = 0;
+    while( ( ptr[ len ] != '\0' ) && ( ptr[ len ] != ',' )
+	   && !isspace( ptr[ len ] ) ) {
+      ++len;
+    }
+
+    int t;
+    for( t = 0; t < TYPE_NUM_TYPES; ++t ) {
+      if( ( ( int ) strlen( entry_type_to_str[ t ] ) == len )
+	  && !strncmp( ptr, entry_type_to_str[ t ], len ) ) {
+	break;
+      }
+    }
+    if( t >= TYPE_NUM_TYPES ) {
+      fprintf( stderr, "Could not parse entry type from [%s]\n", ptr );
+      return 1;
+    }
+    types[ r ] = ( pure_cfr_entry_type_t ) t;
+    ++r;
+    ptr += len;
+  }
+
+  if( r == 0 ) {
+    fprintf( stderr, "No entry types found in [%s]\n", str );
+    return 1;
+  }
+  for( ; r < MAX_ROUNDS; ++r ) {
+    types[ r ] = types[ r - 1 ];
+  }
+
+  return 0;
+}
+
 void Parameters::print_usage( const char *prog_name ) const
 {
   char status_freq_seconds_str[ PATH_LENGTH ];
@@ -51,6 +177,14 @@ void Parameters::print_usage( const char *prog_name ) const
   fprintf( stderr, "  --rng=<seed1:seed2:seed3:seed4|TIME>  "
 	   "(default: %d:%d:%d:%d)\n",
 	   rng_seeds[ 0 ], rng_seeds[ 1 ], rng_seeds[ 2 ], rng_seeds[ 3 ] );
+  fprintf( stderr, "  --rng-type={" );
+  for( int i = 0; i < NUM_RNG_TYPES; ++i ) {
+    if( i > 0 ) {
+      fprintf( stderr, "|" );
+    }
+    fprintf( stderr, "%s", rng_type_to_str[ i ] );
+  }
+  fprintf( stderr, "}  (default: %s)\n", rng_type_to_str[ rng_type ] );
   fprintf( stderr, "  --card-abs={" );
   for( int i = 0; i < NUM_CARD_ABS_TYPES; ++i ) {
     if( i > 0 ) {
@@ -59,6 +193,8 @@ void Parameters::print_usage( const char *prog_name ) const
     fprintf( stderr, "%s", card_abs_type_to_str[ i ] );
   }
   fprintf( stderr, "}  (default: %s)\n", card_abs_type_to_str[ card_abs_type ] );
+  fprintf( stderr, "  --bucket-file=<file>  (buckets for --card-abs=%s)\n",
+	   card_abs_type_to_str[ CARD_ABS_FILE ] );
   fprintf( stderr, "  --action-abs={" );
   for( int i = 0; i < NUM_ACTION_ABS_TYPES; ++i ) {
     if( i > 0 ) {
@@ -67,14 +203,68 @@ void Parameters::print_usage( const char *prog_name ) const
     fprintf( stderr, "%s", action_abs_type_to_str[ i ] );
   }
   fprintf( stderr, "}  (default: %s)\n",
-	   action_abs_type_to_str[ card_abs_type ] );
+	   action_abs_type_to_str[ action_abs_type ] );
+  fprintf( stderr, "  --action-file=<file>  (raise sizes for --action-abs=%s)\n",
+	   action_abs_type_to_str[ ACTION_ABS_CONFIGURABLE ] );
   fprintf( stderr, "  --load-dump=<dump_prefix>\n" );
   fprintf( stderr, "  --threads=<num_threads>  (default: %d)\n", num_threads );
+  fprintf( stderr, "  --thread-control=<file>  (file holding the number of "
+	   "threads to run)\n" );
+  fprintf( stderr, "  --affinity={NONE|COMPACT|SCATTER|<cpu[-cpu],...>}  "
+	   "(default: %s)\n", affinity_type_to_str[ affinity_type ] );
   fprintf( stderr, "  --status=<dd:hh:mm:ss>  (default: %s)\n",
 	   status_freq_seconds_str );
   fprintf( stderr, "  --checkpoint=<start_time[,mult_time[,add_time]]>\n" );
+  fprintf( stderr, "  --checkpoint-mode={" );
+  for( int i = 0; i < NUM_CHECKPOINT_MODES; ++i ) {
+    if( i > 0 ) {
+      fprintf( stderr, "|" );
+    }
+    fprintf( stderr, "%s", checkpoint_mode_to_str[ i ] );
+  }
+  fprintf( stderr, "}  (default: %s)\n",
+	   checkpoint_mode_to_str[ checkpoint_mode ] );
+  fprintf( stderr, "  --chance-sampling={" );
+  for( int i = 0; i < NUM_CHANCE_SAMPLING_TYPES; ++i ) {
+    if( i > 0 ) {
+      fprintf( stderr, "|" );
+    }
+    fprintf( stderr, "%s", chance_sampling_to_str[ i ] );
+  }
+  fprintf( stderr, "}  (default: %s)\n",
+	   chance_sampling_to_str[ chance_sampling ] );
+  fprintf( stderr, "  --hand-batch=<num_hands>  (default: %d)\n", hand_batch );
+  fprintf( stderr, "  --hand-producers=<num_threads>  (default: %d)\n",
+	   hand_producers );
+  fprintf( stderr, "  --hand-buffer=<num_hands>  (default: %d)\n",
+	   hand_ring_depth );
   fprintf( stderr, "  --max-walltime=<dd:hh:mm:ss>\n" );
+  fprintf( stderr, "  --deal-table=<max_deals>  (default: %jd, no table)\n",
+	   ( intmax_t ) max_table_deals );
+  fprintf( stderr, "  --max-iterations=<iterations>\n" );
+  fprintf( stderr, "  --deterministic  (reproducible multi-threaded runs)\n" );
   fprintf( stderr, "  --no-average\n" );
+  fprintf( stderr, "  --regret-types=<type[,type...]>  (default:" );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    fprintf( stderr, "%s%s", ( r > 0 ? "," : " " ),
+	     entry_type_to_str[ regret_types[ r ] ] );
+  }
+  fprintf( stderr, ")\n" );
+  fprintf( stderr, "  --avg-types=<type[,type...]>  (default:" );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    fprintf( stderr, "%s%s", ( r > 0 ? "," : " " ),
+	     entry_type_to_str[ avg_strategy_types[ r ] ] );
+  }
+  fprintf( stderr, ")\n" );
+  fprintf( stderr, "    where type is one of {" );
+  for( int t = 0; t < TYPE_NUM_TYPES; ++t ) {
+    if( t > 0 ) {
+      fprintf( stderr, "|" );
+    }
+    fprintf( stderr, "%s", entry_type_to_str[ t ] );
+  }
+  fprintf( stderr, "}\n" );
+  fprintf( stderr, "  --plan  (print memory requirements and exit)\n" );
 }
 
 int Parameters::parse( const int argc, const char *argv[] )
@@ -127,6 +317,21 @@ int Parameters::parse( const int argc, const char *argv[] )
       }
       rng_set = true;      
       
+    } else if( !strncmp( argv[ index ], "--rng-type=",
+			 strlen( "--rng-type=" ) ) ) {
+      const char *rng_str = &argv[ index ][ strlen( "--rng-type=" ) ];
+      int i;
+      for( i = 0; i < NUM_RNG_TYPES; ++i ) {
+	if( !strcmp( rng_str, rng_type_to_str[ i ] ) ) {
+	  rng_type = ( rng_type_t ) i;
+	  break;
+	}
+      }
+      if( i >= NUM_RNG_TYPES ) {
+	fprintf( stderr, "Could not parse rng type [%s]\n", rng_str );
+	return 1;
+      }
+
     } else if( !strncmp( argv[ index ], "--card-abs=",
 			 strlen( "--card-abs=" ) ) ) {
       const char *abs_str = &argv[ index ][ strlen( "--card-abs=" ) ];
@@ -143,6 +348,11 @@ int Parameters::parse( const int argc, const char *argv[] )
 	return 1;
       }
 
+    } else if( !strncmp( argv[ index ], "--bucket-file=",
+			 strlen( "--bucket-file=" ) ) ) {
+      snprintf( bucket_file, PATH_LENGTH, "%s",
+		&argv[ index ][ strlen( "--bucket-file=" ) ] );
+
     } else if( !strncmp( argv[ index ], "--action-abs=",
 			 strlen( "--action-abs=" ) ) ) {
       const char *abs_str = &argv[ index ][ strlen( "--action-abs=" ) ];
@@ -159,6 +369,11 @@ int Parameters::parse( const int argc, const char *argv[] )
 	return 1;
       }
 
+    } else if( !strncmp( argv[ index ], "--action-file=",
+			 strlen( "--action-file=" ) ) ) {
+      snprintf( action_file, PATH_LENGTH, "%s",
+		&argv[ index ][ strlen( "--action-file=" ) ] );
+
     } else if( !strncmp( argv[ index ], "--load-dump=",
 			 strlen( "--load-dump=" ) ) ) {
       strncpy( load_dump_prefix, &argv[ index ][ strlen( "--load-dump=" ) ], PATH_LENGTH );
@@ -179,6 +394,18 @@ int Parameters::parse( const int argc, const char *argv[] )
     	return 1;
       }
 
+    } else if( !strncmp( argv[ index ], "--thread-control=",
+			 strlen( "--thread-control=" ) ) ) {
+      snprintf( thread_control_file, PATH_LENGTH, "%s",
+		&argv[ index ][ strlen( "--thread-control=" ) ] );
+      thread_control = true;
+
+    } else if( !strncmp( argv[ index ], "--affinity=", strlen( "--affinity=" ) ) ) {
+      if( parse_affinity( &argv[ index ][ strlen( "--affinity=" ) ],
+			  affinity_type, affinity_cpus, num_affinity_cpus ) ) {
+	return 1;
+      }
+
     } else if( !strncmp( argv[ index ], "--status=", strlen( "--status=" ) ) ) {
       status_freq_seconds = time_string_to_seconds( &argv[ index ][ strlen( "--status=" ) ] );
       if( status_freq_seconds <= 0 ) {
@@ -207,21 +434,187 @@ int Parameters::parse( const int argc, const char *argv[] )
 	dump_timer.seconds_add = dump_timer.seconds_start;
       }
       
+    } else if( !strncmp( argv[ index ], "--checkpoint-mode=",
+			 strlen( "--checkpoint-mode=" ) ) ) {
+      const char *mode_str = &argv[ index ][ strlen( "--checkpoint-mode=" ) ];
+      int i;
+      for( i = 0; i < NUM_CHECKPOINT_MODES; ++i ) {
+	if( !strcmp( mode_str, checkpoint_mode_to_str[ i ] ) ) {
+	  checkpoint_mode = ( checkpoint_mode_t ) i;
+	  break;
+	}
+      }
+      if( i >= NUM_CHECKPOINT_MODES ) {
+	fprintf( stderr, "Could not parse checkpoint mode [%s]\n", mode_str );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--chance-sampling=",
+			 strlen( "--chance-sampling=" ) ) ) {
+      const char *sampling_str
+	= &argv[ index ][ strlen( "--chance-sampling=" ) ];
+      int i;
+      for( i = 0; i < NUM_CHANCE_SAMPLING_TYPES; ++i ) {
+	if( !strcmp( sampling_str, chance_sampling_to_str[ i ] ) ) {
+	  chance_sampling = ( chance_sampling_t ) i;
+	  break;
+	}
+      }
+      if( i >= NUM_CHANCE_SAMPLING_TYPES ) {
+	fprintf( stderr, "Could not parse chance sampling type [%s]\n",
+		 sampling_str );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--hand-producers=",
+			 strlen( "--hand-producers=" ) ) ) {
+      if( sscanf( &argv[ index ][ strlen( "--hand-producers=" ) ], "%d",
+		  &hand_producers ) < 1 ) {
+	fprintf( stderr, "could not read number of hand producers from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--hand-buffer=",
+			 strlen( "--hand-buffer=" ) ) ) {
+      if( sscanf( &argv[ index ][ strlen( "--hand-buffer=" ) ], "%d",
+		  &hand_ring_depth ) < 1 ) {
+	fprintf( stderr, "could not read hand buffer size from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--hand-batch=",
+			 strlen( "--hand-batch=" ) ) ) {
+      if( sscanf( &argv[ index ][ strlen( "--hand-batch=" ) ], "%d",
+		  &hand_batch ) < 1 ) {
+	fprintf( stderr, "could not read hand batch size from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
     } else if( !strncmp( argv[ index ], "--max-walltime=", strlen( "--max-walltime=" ) ) ) {
       max_walltime_seconds = time_string_to_seconds( &argv[ index ][ strlen( "--max-walltime=" ) ] );
       if( max_walltime_seconds <= 0 ) {
     	fprintf( stderr, "could not read max walltime from [%s]\n", argv[ index ] );
     	return 1;
       }
+    } else if( !strncmp( argv[ index ], "--deal-table=",
+			 strlen( "--deal-table=" ) ) ) {
+      if( strtoint64_units( &argv[ index ][ strlen( "--deal-table=" ) ],
+			    max_table_deals ) || ( max_table_deals < 0 ) ) {
+	fprintf( stderr, "could not read max deal table size from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--max-iterations=",
+			 strlen( "--max-iterations=" ) ) ) {
+      if( strtoint64_units( &argv[ index ][ strlen( "--max-iterations=" ) ],
+			    max_iterations ) || ( max_iterations <= 0 ) ) {
+	fprintf( stderr, "could not read max iterations from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strcmp( argv[ index ], "--deterministic" ) ) {
+      deterministic = true;
+
     } else if( !strncmp( argv[ index ], "--no-average", strlen( "--no-average" ) ) ) {
       do_average = false;
 
+    } else if( !strncmp( argv[ index ], "--regret-types=",
+			 strlen( "--regret-types=" ) ) ) {
+      if( parse_entry_types( &argv[ index ][ strlen( "--regret-types=" ) ],
+			     regret_types ) ) {
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--avg-types=",
+			 strlen( "--avg-types=" ) ) ) {
+      if( parse_entry_types( &argv[ index ][ strlen( "--avg-types=" ) ],
+			     avg_strategy_types ) ) {
+	return 1;
+      }
+
+    } else if( !strcmp( argv[ index ], "--plan" ) ) {
+      plan_only = true;
+
     } else {
       fprintf( stderr, "unknown option [%s]\n", argv[ index ] );
       return 1;
     }
   }
   
+  if( ( num_threads < 1 ) || ( num_threads > MAX_WORKER_THREADS ) ) {
+    fprintf( stderr, "number of threads must be between 1 and %d\n",
+	     MAX_WORKER_THREADS );
+    return 1;
+  }
+
+  if( ( card_abs_type == CARD_ABS_FILE ) != ( bucket_file[ 0 ] != '\0' ) ) {
+    fprintf( stderr, "--card-abs=%s and --bucket-file must be used together\n",
+	     card_abs_type_to_str[ CARD_ABS_FILE ] );
+    return 1;
+  }
+
+  if( ( action_abs_type == ACTION_ABS_CONFIGURABLE )
+      != ( action_file[ 0 ] != '\0' ) ) {
+    fprintf( stderr, "--action-abs=%s and --action-file must be used "
+	     "together\n", action_abs_type_to_str[ ACTION_ABS_CONFIGURABLE ] );
+    return 1;
+  }
+
+  if( deterministic && thread_control ) {
+    fprintf( stderr, "--deterministic needs a fixed number of threads, so it "
+	     "cannot be used with --thread-control\n" );
+    return 1;
+  }
+
+  if( ( hand_producers < 0 ) || ( hand_producers > MAX_WORKER_THREADS ) ) {
+    fprintf( stderr, "number of hand producers must be between 0 and %d\n",
+	     MAX_WORKER_THREADS );
+    return 1;
+  }
+  if( ( hand_ring_depth < 1 ) || ( hand_ring_depth > MAX_HAND_RING_DEPTH ) ) {
+    fprintf( stderr, "hand buffer size must be between 1 and %d\n",
+	     MAX_HAND_RING_DEPTH );
+    return 1;
+  }
+  if( ( hand_producers > 0 )
+      && ( deterministic
+	   || ( chance_sampling != CHANCE_SAMPLING_UNIFORM ) ) ) {
+    fprintf( stderr, "--hand-producers deals hands independently of the "
+	     "workers, so it cannot be used with --deterministic or "
+	     "--chance-sampling=%s\n",
+	     chance_sampling_to_str[ chance_sampling ] );
+    return 1;
+  }
+  if( ( chance_sampling == CHANCE_SAMPLING_PUBLIC )
+      && ( ( hand_batch > 1 ) || ( max_table_deals > 0 ) ) ) {
+    fprintf( stderr, "--chance-sampling=%s does not deal whole hands, so it "
+	     "cannot be used with --hand-batch or --deal-table\n",
+	     chance_sampling_to_str[ CHANCE_SAMPLING_PUBLIC ] );
+    return 1;
+  }
+
+  if( ( hand_batch < 1 ) || ( hand_batch > MAX_HAND_BATCH ) ) {
+    fprintf( stderr, "hand batch size must be between 1 and %d\n",
+	     MAX_HAND_BATCH );
+    return 1;
+  }
+
+  /* Regrets can be negative, so only signed types are allowed */
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    if( ( regret_types[ r ] != TYPE_INT )
+	&& ( regret_types[ r ] != TYPE_INT64_T ) ) {
+      fprintf( stderr, "regret type [%s] for round %d is not signed; "
+	       "only INT and INT64 are allowed\n",
+	       entry_type_to_str[ regret_types[ r ] ], r );
+      return 1;
+    }
+  }
+
   /* all done */
   return 0;
 }
@@ -232,22 +625,67 @@ void Parameters::print_params( FILE *file ) const
   fprintf( file, "OUTPUT_PREFIX %s\n", output_prefix );
   fprintf( file, "RNG_SEEDS %u %u %u %u\n", rng_seeds[ 0 ], rng_seeds[ 1 ],
 	   rng_seeds[ 2 ], rng_seeds[ 3 ] );
+  fprintf( file, "RNG_TYPE %s\n", rng_type_to_str[ rng_type ] );
   fprintf( file, "CARD_ABSTRACTION %s\n", card_abs_type_to_str[ card_abs_type ] );
+  if( card_abs_type == CARD_ABS_FILE ) {
+    fprintf( file, "BUCKET_FILE %s\n", bucket_file );
+  }
   fprintf( file, "ACTION_ABSTRACTION %s\n",
 	   action_abs_type_to_str[ action_abs_type ] );
+  if( action_abs_type == ACTION_ABS_CONFIGURABLE ) {
+    fprintf( file, "ACTION_FILE %s\n", action_file );
+  }
   if( load_dump ) {
     fprintf( file, "LOAD_DUMP_PREFIX %s\n", load_dump_prefix );
   }
   fprintf( file, "NUM_THREADS %d\n", num_threads );
+  if( thread_control ) {
+    fprintf( file, "THREAD_CONTROL_FILE %s\n", thread_control_file );
+  }
+  if( affinity_type == AFFINITY_LIST ) {
+    fprintf( file, "AFFINITY " );
+    for( int i = 0; i < num_affinity_cpus; ++i ) {
+      fprintf( file, "%s%d", ( i > 0 ? "," : "" ), affinity_cpus[ i ] );
+    }
+    fprintf( file, "\n" );
+  } else {
+    fprintf( file, "AFFINITY %s\n", affinity_type_to_str[ affinity_type ] );
+  }
   fprintf( file, "STATUS_FREQ_SECONDS %d\n", status_freq_seconds );
   fprintf( file, "DUMP_TIMER %d %d %d\n", dump_timer.seconds_start,
 	   dump_timer.seconds_mult, dump_timer.seconds_add );
+  fprintf( file, "CHECKPOINT_MODE %s\n",
+	   checkpoint_mode_to_str[ checkpoint_mode ] );
+  fprintf( file, "CHANCE_SAMPLING %s\n",
+	   chance_sampling_to_str[ chance_sampling ] );
+  fprintf( file, "HAND_BATCH %d\n", hand_batch );
+  fprintf( file, "HAND_PRODUCERS %d\n", hand_producers );
+  fprintf( file, "HAND_BUFFER %d\n", hand_ring_depth );
   fprintf( file, "MAX_WALLTIME_SECONDS %d\n", max_walltime_seconds );
+  fprintf( file, "DEAL_TABLE %jd\n", ( intmax_t ) max_table_deals );
+  if( max_iterations < INT64_MAX ) {
+    fprintf( file, "MAX_ITERATIONS %jd\n", ( intmax_t ) max_iterations );
+  }
+  if( deterministic ) {
+    fprintf( file, "DETERMINISTIC TRUE\n" );
+  } else {
+    fprintf( file, "DETERMINISTIC FALSE\n" );
+  }
   if( do_average ) {
     fprintf( file, "DO_AVERAGE TRUE\n" );
   } else {
     fprintf( file, "DO_AVERAGE FALSE\n" );
   }
+  fprintf( file, "REGRET_TYPES" );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    fprintf( file, " %s", entry_type_to_str[ regret_types[ r ] ] );
+  }
+  fprintf( file, "\n" );
+  fprintf( file, "AVG_STRATEGY_TYPES" );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    fprintf( file, " %s", entry_type_to_str[ avg_strategy_types[ r ] ] );
+  }
+  fprintf( file, "\n" );
   fprintf( file, "PARAMETERS_END\n" );
 }
 
@@ -290,6 +728,24 @@ int Parameters::read_params( FILE *file )
 	return 1;
       }
       
+    } else if( !strncmp( line, "RNG_TYPE", strlen( "RNG_TYPE" ) ) ) {
+      char rng_str[ PATH_LENGTH ];
+      if( get_next_token( rng_str, &line[ strlen( "RNG_TYPE" ) ] ) ) {
+	fprintf( stderr, "Error reading RNG_TYPE from line [%s]\n", line );
+	return 1;
+      }
+      int i;
+      for( i = 0; i < NUM_RNG_TYPES; ++i ) {
+	if( !strcmp( rng_str, rng_type_to_str[ i ] ) ) {
+	  break;
+	}
+      }
+      rng_type = ( rng_type_t ) i;
+      if( rng_type == NUM_RNG_TYPES ) {
+	fprintf( stderr, "Unrecognized rng type from line [%s]\n", line );
+	return 1;
+      }
+
     } else if( !strncmp( line, "CARD_ABSTRACTION",
 			 strlen( "CARD_ABSTRACTION" ) ) ) {
       char card_abs_str[ PATH_LENGTH ];
@@ -312,6 +768,12 @@ int Parameters::read_params( FILE *file )
 	return 1;
       }
       
+    } else if( !strncmp( line, "BUCKET_FILE", strlen( "BUCKET_FILE" ) ) ) {
+      if( get_next_token( bucket_file, &line[ strlen( "BUCKET_FILE" ) ] ) ) {
+	fprintf( stderr, "Error reading BUCKET_FILE from line [%s]\n", line );
+	return 1;
+      }
+
     } else if( !strncmp( line, "ACTION_ABSTRACTION",
 			 strlen( "ACTION_ABSTRACTION" ) ) ) { 
       char action_abs_str[ PATH_LENGTH ];
@@ -333,6 +795,12 @@ int Parameters::read_params( FILE *file )
 		 line );
 	return 1;
       }
+
+    } else if( !strncmp( line, "ACTION_FILE", strlen( "ACTION_FILE" ) ) ) {
+      if( get_next_token( action_file, &line[ strlen( "ACTION_FILE" ) ] ) ) {
+	fprintf( stderr, "Error reading ACTION_FILE from line [%s]\n", line );
+	return 1;
+      }
       
     } else if( !strncmp( line, "LOAD_DUMP_PREFIX",
 			 strlen( "LOAD_DUMP_PREFIX" ) ) ) {
@@ -355,6 +823,25 @@ int Parameters::read_params( FILE *file )
 	return 1;
       }
       
+    } else if( !strncmp( line, "THREAD_CONTROL_FILE",
+			 strlen( "THREAD_CONTROL_FILE" ) ) ) {
+      thread_control = true;
+      if( get_next_token( thread_control_file,
+			  &line[ strlen( "THREAD_CONTROL_FILE" ) ] ) ) {
+	fprintf( stderr, "Error reading THREAD_CONTROL_FILE from line [%s]\n",
+		 line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "AFFINITY", strlen( "AFFINITY" ) ) ) {
+      char affinity_str[ PATH_LENGTH ];
+      if( get_next_token( affinity_str, &line[ strlen( "AFFINITY" ) ] )
+	  || parse_affinity( affinity_str, affinity_type, affinity_cpus,
+			     num_affinity_cpus ) ) {
+	fprintf( stderr, "Error reading AFFINITY from line [%s]\n", line );
+	return 1;
+      }
+
     } else if( !strncmp( line, "STATUS_FREQ_SECONDS",
 			 strlen( "STATUS_FREQ_SECONDS" ) ) ) {
       /* Skip whitespace */
@@ -380,6 +867,82 @@ int Parameters::read_params( FILE *file )
 	return 1;
       }
 
+    } else if( !strncmp( line, "CHECKPOINT_MODE",
+			 strlen( "CHECKPOINT_MODE" ) ) ) {
+      char mode_str[ PATH_LENGTH ];
+      if( get_next_token( mode_str, &line[ strlen( "CHECKPOINT_MODE" ) ] ) ) {
+	fprintf( stderr, "Error reading CHECKPOINT_MODE from line [%s]\n",
+		 line );
+	return 1;
+      }
+      int i;
+      for( i = 0; i < NUM_CHECKPOINT_MODES; ++i ) {
+	if( !strcmp( mode_str, checkpoint_mode_to_str[ i ] ) ) {
+	  break;
+	}
+      }
+      checkpoint_mode = ( checkpoint_mode_t ) i;
+      if( checkpoint_mode == NUM_CHECKPOINT_MODES ) {
+	fprintf( stderr, "Unrecognized checkpoint mode from line [%s]\n",
+		 line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "CHANCE_SAMPLING",
+			 strlen( "CHANCE_SAMPLING" ) ) ) {
+      char sampling_str[ PATH_LENGTH ];
+      if( get_next_token( sampling_str,
+			  &line[ strlen( "CHANCE_SAMPLING" ) ] ) ) {
+	fprintf( stderr, "Error reading CHANCE_SAMPLING from line [%s]\n",
+		 line );
+	return 1;
+      }
+      int i;
+      for( i = 0; i < NUM_CHANCE_SAMPLING_TYPES; ++i ) {
+	if( !strcmp( sampling_str, chance_sampling_to_str[ i ] ) ) {
+	  break;
+	}
+      }
+      chance_sampling = ( chance_sampling_t ) i;
+      if( chance_sampling == NUM_CHANCE_SAMPLING_TYPES ) {
+	fprintf( stderr, "Unrecognized chance sampling type from line [%s]\n",
+		 line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "HAND_PRODUCERS", strlen( "HAND_PRODUCERS" ) ) ) {
+      /* Skip whitespace */
+      int i = strlen( "HAND_PRODUCERS" );
+      while( isspace( line[ i ] ) || line[ i ] == '=' ) {
+	++i;
+      }
+      if( sscanf( &line[ i ], "%d", &hand_producers ) < 1 ) {
+	fprintf( stderr, "Error reading HAND_PRODUCERS from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "HAND_BUFFER", strlen( "HAND_BUFFER" ) ) ) {
+      /* Skip whitespace */
+      int i = strlen( "HAND_BUFFER" );
+      while( isspace( line[ i ] ) || line[ i ] == '=' ) {
+	++i;
+      }
+      if( sscanf( &line[ i ], "%d", &hand_ring_depth ) < 1 ) {
+	fprintf( stderr, "Error reading HAND_BUFFER from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "HAND_BATCH", strlen( "HAND_BATCH" ) ) ) {
+      /* Skip whitespace */
+      int i = strlen( "HAND_BATCH" );
+      while( isspace( line[ i ] ) || line[ i ] == '=' ) {
+	++i;
+      }
+      if( sscanf( &line[ i ], "%d", &hand_batch ) < 1 ) {
+	fprintf( stderr, "Error reading HAND_BATCH from line [%s]\n", line );
+	return 1;
+      }
+
     } else if( !strncmp( line, "MAX_WALLTIME_SECONDS",
 			 strlen( "MAX_WALLTIME_SECONDS" ) ) ) {
       /* Skip whitespace */
@@ -393,6 +956,41 @@ int Parameters::read_params( FILE *file )
 	return 1;
       }
 
+    } else if( !strncmp( line, "DEAL_TABLE", strlen( "DEAL_TABLE" ) ) ) {
+      char tmp[ PATH_LENGTH ];
+      if( get_next_token( tmp, &line[ strlen( "DEAL_TABLE" ) ] )
+	  || strtoint64_units( tmp, max_table_deals )
+	  || ( max_table_deals < 0 ) ) {
+	fprintf( stderr, "Error reading DEAL_TABLE from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "MAX_ITERATIONS", strlen( "MAX_ITERATIONS" ) ) ) {
+      char tmp[ PATH_LENGTH ];
+      if( get_next_token( tmp, &line[ strlen( "MAX_ITERATIONS" ) ] )
+	  || strtoint64_units( tmp, max_iterations )
+	  || ( max_iterations <= 0 ) ) {
+	fprintf( stderr, "Error reading MAX_ITERATIONS from line [%s]\n",
+		 line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "DETERMINISTIC", strlen( "DETERMINISTIC" ) ) ) {
+      char tmp[ PATH_LENGTH ];
+      if( get_next_token( tmp, &line[ strlen( "DETERMINISTIC" ) ] ) ) {
+	fprintf( stderr, "Error reading DETERMINISTIC from line [%s]\n", line );
+	return 1;
+      }
+      if( !strcmp( tmp, "TRUE" ) ) {
+	deterministic = true;
+      } else if( !strcmp( tmp, "FALSE" ) ) {
+	deterministic = false;
+      } else {
+	fprintf( stderr, "Unknown DETERMINISTIC type, must be either TRUE or "
+		 "FALSE, received [%s] from line [%s]\n", tmp, line );
+	return 1;
+      }
+
     } else if( !strncmp( line, "DO_AVERAGE", strlen( "DO_AVERAGE" ) ) ) {
       char tmp[ PATH_LENGTH ];
       if( get_next_token( tmp, &line[ strlen( "DO_AVERAGE" ) ] ) ) {
@@ -408,6 +1006,22 @@ int Parameters::read_params( FILE *file )
 		 "FALSE, received [%s] from line [%s]\n", tmp, line );
 	return 1;
       }
+
+    } else if( !strncmp( line, "REGRET_TYPES", strlen( "REGRET_TYPES" ) ) ) {
+      if( parse_entry_types( &line[ strlen( "REGRET_TYPES" ) ],
+			     regret_types ) ) {
+	fprintf( stderr, "Error reading REGRET_TYPES from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "AVG_STRATEGY_TYPES",
+			 strlen( "AVG_STRATEGY_TYPES" ) ) ) {
+      if( parse_entry_types( &line[ strlen( "AVG_STRATEGY_TYPES" ) ],
+			     avg_strategy_types ) ) {
+	fprintf( stderr, "Error reading AVG_STRATEGY_TYPES from line [%s]\n",
+		 line );
+	return 1;
+      }
     }
   }
 
@@ -47,15 +47,34 @@ public:
 
   /* Optional parameters */
   uint32_t rng_seeds[ NUM_RNG_SEEDS ];
+  rng_type_t rng_type;
   card_abs_type_t card_abs_type;
+  char bucket_file[ PATH_LENGTH ]; /* only used for CARD_ABS_FILE */
   action_abs_type_t action_abs_type;
+  char action_file[ PATH_LENGTH ]; /* only used for ACTION_ABS_CONFIGURABLE */
   bool load_dump;
   char load_dump_prefix[ PATH_LENGTH ];
   int num_threads;
+  bool thread_control;
+  char thread_control_file[ PATH_LENGTH ];
+  affinity_type_t affinity_type;
+  int affinity_cpus[ MAX_AFFINITY_CPUS ]; /* only used for AFFINITY_LIST */
+  int num_affinity_cpus;
   int status_freq_seconds;
   output_timer_t dump_timer;
+  checkpoint_mode_t checkpoint_mode;
+  chance_sampling_t chance_sampling;
+  int hand_batch;
+  int hand_producers;
+  int hand_ring_depth;
+  int64_t max_table_deals;
   int max_walltime_seconds;
+  int64_t max_iterations;
+  bool deterministic;
   bool do_average;
+  pure_cfr_entry_type_t regret_types[ MAX_ROUNDS ];
+  pure_cfr_entry_type_t avg_strategy_types[ MAX_ROUNDS ];
+  bool plan_only;
 };
 
 #endif
@@ -108,6 +108,16 @@ PlayerModule::PlayerModule( const char *player_file )
 	  MAX_ROUNDS * sizeof( num_entries_per_bucket[ 0 ] ) );
   memset( total_num_entries, 0, MAX_ROUNDS * sizeof( total_num_entries[ 0 ] ) );
   ag->count_entries( num_entries_per_bucket, total_num_entries );
+
+  /* Action probabilities are sized by the busiest node of the tree */
+  size_t num_choice_nodes[ MAX_ROUNDS ];
+  size_t num_info_sets[ MAX_ROUNDS ];
+  size_t num_terminal_nodes = 0;
+  memset( num_choice_nodes, 0, MAX_ROUNDS * sizeof( num_choice_nodes[ 0 ] ) );
+  memset( num_info_sets, 0, MAX_ROUNDS * sizeof( num_info_sets[ 0 ] ) );
+  max_num_actions = 1;
+  ag->count_nodes( num_choice_nodes, num_info_sets, num_terminal_nodes,
+		   max_num_actions );
   
   /* Finally, build the entries from the dump */
   for( int r = 0; r < MAX_ROUNDS; ++r ) {
@@ -144,41 +154,27 @@ PlayerModule::~PlayerModule( )
 }
 
 void PlayerModule::get_action_probs( State &state,
-				      double action_probs
-				      [ MAX_ABSTRACT_ACTIONS ],
+				      double *action_probs,
 				      int bucket )
 {
-  /* Initialize action probs to the default in case we must abort early
-   * for one of several reasons
-   */  
-  get_default_action_probs( state, action_probs );
-  
-  if( verbose ) {
-    char tmp[ PATH_LENGTH ];
-    printState( ag->game, &state, PATH_LENGTH, tmp );
-    fprintf( stderr, "\nCurrent real state: %s\n", tmp );
-  }
+  Action actions[ MAX_ABSTRACT_ACTIONS ];
+  int num_actions;
+  get_actions_and_probs( state, actions, num_actions, action_probs, bucket );
+}
 
-  /* Find the current node from the sequence of actions in state */
+const BettingNode *PlayerModule::find_node( const State &state,
+					    bool &on_tree )
+{
   const BettingNode *node = ag->betting_tree_root;
-  State old_state;
-  initState( ag->game, 0, &old_state );
+  on_tree = true;
   if( verbose ) {
     fprintf( stderr, "Translated abstract state: " );
   }
   for( int r = 0; r <= state.round; ++r ) {
     for( int a = 0; a < state.numActions[ r ]; ++a ) {
       const Action real_action = state.action[ r ][ a ];
-      Action abstract_actions[ MAX_ABSTRACT_ACTIONS ];
-      int num_actions = ag->action_abs->get_actions( ag->game, old_state,
-						     abstract_actions );
-      if( num_actions != node->get_num_choices( ) ) {
-	if( verbose ) {
-	  fprintf( stderr, "Number of actions %d does not match number "
-		   "of choices %d\n", num_actions, node->get_num_choices( ) );
-	}
-	return;
-      }
+      const Action *abstract_actions = ag->get_node_actions( node );
+      const int num_actions = node->get_num_choices( );
       int choice;
       if( ( ag->game->bettingType == noLimitBetting )
 	  && ( real_action.type == a_raise ) ) {
@@ -224,7 +220,7 @@ void PlayerModule::get_action_probs( State &state,
 	      fprintf( stderr, "Could not translate at round %d turn %d\n",
 		       r, a );
 	    }
-	    return;
+	    return NULL;
 	  }
 	  choice = upper_choice;
 	} else if( upper_choice == -1 ) {
@@ -234,7 +230,7 @@ void PlayerModule::get_action_probs( State &state,
 	      fprintf( stderr, "Could not translate at round %d turn %d\n",
 		       r, a );
 	    }
-	    return;
+	    return NULL;
 	  }
 	  choice = lower_choice;
 	} else {
@@ -275,7 +271,7 @@ void PlayerModule::get_action_probs( State &state,
 	    }
 	    fprintf( stderr, "\n" );
 	  }
-	  return;
+	  return NULL;
 	}
       }
 
@@ -285,7 +281,7 @@ void PlayerModule::get_action_probs( State &state,
 		     PATH_LENGTH, action_str );
 	fprintf( stderr, " %s", action_str );
       }
-      /* Move the current node and old_state along */
+      /* Move the current node along to the chosen child */
       node = node->get_child( );
       for( int i = 0; i < choice; ++i ) {
 	node = node->get_sibling( );
@@ -293,19 +289,70 @@ void PlayerModule::get_action_probs( State &state,
 	  if( verbose ) {
 	    fprintf( stderr, "Ran out of siblings for choice %d\n", choice );
 	  }
-	  return;
+	  return NULL;
 	}
       }
       if( node->get_child( ) == NULL ) {
 	if( verbose ) {
 	  fprintf( stderr, " Abstract game over\n" );
 	}
-	return;
+	return NULL;
+      }
+      if( ( abstract_actions[ choice ].type != real_action.type )
+	  || ( abstract_actions[ choice ].size != real_action.size ) ) {
+	on_tree = false;
       }
-      doAction( ag->game, &abstract_actions[ choice ], &old_state );
     }
   }
 
+  return node;
+}
+
+const Action *PlayerModule::get_actions_and_probs( State &state,
+						   Action actions_buf
+						   [ MAX_ABSTRACT_ACTIONS ],
+						   int &num_actions,
+						   double *action_probs,
+						   int bucket )
+{
+  if( verbose ) {
+    char tmp[ PATH_LENGTH ];
+    printState( ag->game, &state, PATH_LENGTH, tmp );
+    fprintf( stderr, "\nCurrent real state: %s\n", tmp );
+  }
+
+  /* Find the current node from the sequence of actions in state */
+  bool on_tree;
+  const BettingNode *node = find_node( state, on_tree );
+
+  /* Use the actions kept in the tree, unless state has left the abstract
+   * game and the abstraction must be asked about the real state
+   */
+  const Action *actions;
+  if( ( node != NULL ) && on_tree ) {
+    actions = ag->get_node_actions( node );
+    num_actions = node->get_num_choices( );
+  } else {
+    num_actions = ag->action_abs->get_actions( ag->game, state, actions_buf );
+    actions = actions_buf;
+    if( num_actions > max_num_actions ) {
+      /* More than any node of the tree has, so drop the largest raises */
+      if( verbose ) {
+	fprintf( stderr, "Keeping only the first %d of %d actions\n",
+		 max_num_actions, num_actions );
+      }
+      num_actions = max_num_actions;
+    }
+  }
+
+  /* Initialize action probs to the default in case we must abort early
+   * for one of several reasons
+   */
+  get_default_action_probs( actions, num_actions, action_probs );
+  if( node == NULL ) {
+    return actions;
+  }
+
   /* Bucket the cards */
   if( bucket == -1 ) {
     bucket = ag->card_abs->get_bucket( ag->game, node,
@@ -320,13 +367,13 @@ void PlayerModule::get_action_probs( State &state,
     if( verbose ) {
       fprintf( stderr, "Abstract player does not match current player\n" );
     }
-    return;
+    return actions;
   }
   if( state.round != node->get_round( ) ) {
     if( verbose ) {
       fprintf( stderr, "Abstract round does not match current round\n" );
     }
-    return;
+    return actions;
   }
 
   /* Get the positive entries at this information set */
@@ -344,23 +391,26 @@ void PlayerModule::get_action_probs( State &state,
     if( verbose ) {
       fprintf( stderr, "ALL POSITIVE ENTRIES ARE ZERO\n" );
     }
-    return;
+    return actions;
   }
-  memset( action_probs, 0, MAX_ABSTRACT_ACTIONS * sizeof( action_probs[ 0 ] ) );
+  memset( action_probs, 0, num_actions * sizeof( action_probs[ 0 ] ) );
   for( int c = 0; c < num_choices; ++c ) {
     action_probs[ c ] = 1.0 * pos_entries[ c ] / sum_pos_entries;
   }
+
+  return actions;
 }
 
 Action PlayerModule::get_action( State &state )
 {
-  /* Get the abstract game action probabilities */
-  double action_probs[ MAX_ABSTRACT_ACTIONS ];
-  get_action_probs( state, action_probs );
-
-  /* Get the corresponding actions */
-  Action actions[ MAX_ABSTRACT_ACTIONS ];
-  int num_choices = ag->action_abs->get_actions( ag->game, state, actions );
+  /* Get the abstract game action probabilities and the corresponding
+   * actions
+   */
+  double action_probs[ max_num_actions ];
+  Action actions_buf[ MAX_ABSTRACT_ACTIONS ];
+  int num_choices;
+  const Action *actions = get_actions_and_probs( state, actions_buf,
+						 num_choices, action_probs );
   if( verbose ) {
     fprintf( stderr, "probs:" );
     for( int a = 0; a < num_choices; ++a ) {
@@ -382,39 +432,36 @@ Action PlayerModule::get_action( State &state )
     }
     dart -= action_probs[ a ];
   }
+  Action action = actions[ a ];
   if( verbose ) {
     char action_str[ PATH_LENGTH ];
-    printAction( ag->game, &actions[ a ], PATH_LENGTH, action_str );
+    printAction( ag->game, &action, PATH_LENGTH, action_str );
     fprintf( stderr, "Action %s chosen\n", action_str );
   }
 
   /* Make sure action is legal */
-  if( !isValidAction( ag->game, &state, 1, &actions[ a ] ) ) {
+  if( !isValidAction( ag->game, &state, 1, &action ) ) {
     if( verbose ) {
       char action_str[ PATH_LENGTH ];
-      printAction( ag->game, &actions[ a ], PATH_LENGTH, action_str );
+      printAction( ag->game, &action, PATH_LENGTH, action_str );
       fprintf( stderr, "Action chosen is not legal, "
 	       "now choosing fixed action %s instead\n", action_str );
     }
   }
 
-  return actions[ a ];
+  return action;
 }
 
-void PlayerModule::get_default_action_probs( State &state,
-					     double action_probs
-					     [ MAX_ABSTRACT_ACTIONS ] ) const
+void PlayerModule::get_default_action_probs( const Action *actions,
+					     const int num_actions,
+					     double *action_probs ) const
 {
   /* Default will be always call */
   
-  memset( action_probs, 0, MAX_ABSTRACT_ACTIONS * sizeof( action_probs[ 0 ] ) );
+  memset( action_probs, 0, num_actions * sizeof( action_probs[ 0 ] ) );
   
-  /* Get the abstract actions */
-  Action actions[ MAX_ABSTRACT_ACTIONS ];
-  int num_choices = ag->action_abs->get_actions( ag->game, state, actions );
-
   /* Find the call action */
-  for( int a = 0; a < num_choices; ++a ) {
+  for( int a = 0; a < num_actions; ++a ) {
     if( actions[ a ].type == a_call ) {
       action_probs[ a ] = 1.0;
       return;
@@ -32,20 +32,41 @@ public:
   virtual ~PlayerModule( );
 
   virtual const AbstractGame *get_abstract_game( ) const { return ag; }
+  /* Most choices at any node of the tree, which action_probs arrays must
+   * have room for
+   */
+  virtual int get_max_num_actions( ) const { return max_num_actions; }
 
   virtual void get_action_probs( State &state,
-				 double action_probs
-				 [ MAX_ABSTRACT_ACTIONS ],
+				 double *action_probs,
 				 int bucket = -1 );
   virtual Action get_action( State &state );
 
 protected:
 
-  virtual void get_default_action_probs( State &state,
-					 double action_probs
-					 [ MAX_ABSTRACT_ACTIONS ] ) const;
+  /* Follows the actions taken in state down the abstract game tree,
+   * translating raises that are not in the abstraction.  Returns the
+   * information set node reached, or NULL if state cannot be followed, and
+   * sets on_tree if every action taken was in the abstraction.
+   */
+  virtual const BettingNode *find_node( const State &state, bool &on_tree );
+  /* Sets action_probs and returns the abstract actions they are over, which
+   * are kept by the abstract game unless state has left it, in which case
+   * they are found for state and written to actions_buf.  No more than
+   * get_max_num_actions( ) actions are returned.
+   */
+  virtual const Action *get_actions_and_probs( State &state,
+					       Action actions_buf
+					       [ MAX_ABSTRACT_ACTIONS ],
+					       int &num_actions,
+					       double *action_probs,
+					       int bucket = -1 );
+  virtual void get_default_action_probs( const Action *actions,
+					 const int num_actions,
+					 double *action_probs ) const;
   
   const AbstractGame *ag;
+  int max_num_actions;
   rng_state_t rng;
   bool verbose;
   Entries *entries[ MAX_ROUNDS ];
@@ -22,6 +22,7 @@ extern "C" {
 
 static void print_strategy_r( PlayerModule &player_module,
 			      State &state,
+			      const BettingNode *node,
 			      const AbstractGame *ag,
 			      const int p,
 			      const int max_round )
@@ -31,9 +32,9 @@ static void print_strategy_r( PlayerModule &player_module,
     return;
   }
 
-  /* Get the possible actions */
-  Action actions[ MAX_ABSTRACT_ACTIONS ];
-  const int num_choices = ag->action_abs->get_actions( ag->game, state, actions );
+  /* Get the possible actions, as kept when the tree was built */
+  const Action *actions = ag->get_node_actions( node );
+  const int num_choices = node->get_num_choices( );
     
   if( p == currentPlayer( ag->game, &state ) ) {
     /* Get the state info in a string */
@@ -55,7 +56,7 @@ static void print_strategy_r( PlayerModule &player_module,
     for( int bucket = 0; bucket < num_buckets; ++bucket ) {
 
       /* Get the action probabilities */
-      double action_probs[ MAX_ABSTRACT_ACTIONS ];
+      double action_probs[ player_module.get_max_num_actions( ) ];
       player_module.get_action_probs( state, action_probs, bucket );
 
       /* Print 'em out */
@@ -72,11 +73,13 @@ static void print_strategy_r( PlayerModule &player_module,
   }
 
   /* Recurse */
+  const BettingNode *child = node->get_child( );
   for( int a = 0; a < num_choices; ++a ) {
 
     State new_state( state );
     doAction( ag->game, &actions[ a ], &new_state );
-    print_strategy_r( player_module, new_state, ag, p, max_round );
+    print_strategy_r( player_module, new_state, child, ag, p, max_round );
+    child = child->get_sibling( );
   }
 }
 
@@ -124,7 +127,8 @@ int main( const int argc, const char *argv[] )
   for( int p = 0; p < ag->game->numPlayers; ++p ) {
     initState( ag->game, 0, &state );
     printf( "=== PLAYER %d ===\n", p + 1 );
-    print_strategy_r( player_module, state, ag, p, max_round );
+    print_strategy_r( player_module, state, ag->betting_tree_root, ag, p,
+		      max_round );
   }
 
   return 0;
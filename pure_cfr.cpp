@@ -16,6 +16,11 @@
 #include <sys/time.h>
 #include <assert.h>
 #include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <errno.h>
 
 /* C project-acpc-server includes */
 extern "C" {
@@ -27,22 +32,77 @@ extern "C" {
 #include "pure_cfr_machine.hpp"
 #include "player_module.hpp"
 #include "utility.hpp"
+#include "cpu_topology.hpp"
+#include "hand_ring.hpp"
 
 typedef struct {
   int64_t iterations;
   int seconds;
 } pure_cfr_counter_t;
 
+/* Shared state used to pause, resume and stop the worker threads.
+ * Workers poll do_pause with a cheap atomic load between iterations
+ * and block on resume_cond while paused, so a pause takes effect within
+ * one iteration rather than one block of iterations.
+ */
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t paused_cond; /* signalled when a worker pauses or exits */
+  pthread_cond_t resume_cond; /* broadcast when the pause is lifted */
+  int do_pause; /* also set when quitting so workers stop promptly */
+  int do_quit;
+  int num_paused;
+  /* Deterministic mode only */
+  pthread_barrier_t epoch_barrier; /* all threads meet at epoch ends */
+  int epoch_pause; /* thread 0's pause decision for everyone */
+  int64_t max_run_iterations; /* iterations this run may do before holding */
+  int hold; /* set once max_run_iterations is reached */
+} worker_control_t;
+
+/* A worker's sampling state, saved in deterministic checkpoints so that a
+ * resumed run carries on exactly where it left off
+ */
+typedef struct {
+  rng_engine_t rng;
+  int partition_index;
+  int partition_count;
+  /* Stratified sampling visits hole class
+   * ( stratum_offset + stratum_count * stratum_stride ) % num_classes
+   */
+  int stratum_offset;
+  int stratum_stride;
+  int stratum_count;
+  bool loaded; /* restored from a checkpoint rather than seeded */
+} worker_state_t;
+
 typedef struct {
   int thread_num;
   Parameters *params;
   PureCfrMachine *pcm;
-  int64_t iterations;
-  int *do_pause;
-  int am_paused;
-  int *do_quit;
+  int seed_num; /* distinct for every worker launched during the run */
+  thread_stats_t *stats;
+  worker_state_t *state;
+  update_log_t *update_logs; /* every thread's log, deterministic mode only */
+  worker_control_t *control;
+  hand_ring_t *ring; /* hands dealt for this worker, or NULL */
+  int do_stop; /* set to retire this worker when the pool shrinks */
 } worker_thread_args_t;
 
+typedef struct {
+  int producer_num;
+  Parameters *params;
+  PureCfrMachine *pcm;
+  hand_ring_t *rings; /* one per worker slot */
+  worker_control_t *control;
+} producer_thread_args_t;
+
+/* A checkpoint being written by a forked child process */
+typedef struct {
+  pid_t pid; /* 0 if no child is writing */
+  char prefix[ PATH_LENGTH ];
+  struct timeval start_time;
+} dump_child_t;
+
 pthread_attr_t thread_attributes;
 
 void init_pure_cfr_counter( pure_cfr_counter_t &counter )
@@ -87,53 +147,754 @@ int set_pure_cfr_counter( const char *load_dump_prefix,
   return 0;
 }
 
+/* Writes the counters and saturation histograms at a checkpoint alongside
+ * the dump files.  Returns 0 on success, 1 on failure.
+ */
+int write_stats_file( const char *filename_prefix,
+		      const int64_t iterations,
+		      const int work_seconds,
+		      const PureCfrMachine &pcm,
+		      const saturation_t regret_sat[ MAX_ROUNDS ],
+		      const saturation_t avg_sat[ MAX_ROUNDS ] )
+{
+  char filename[ PATH_LENGTH ];
+  snprintf( filename, PATH_LENGTH, "%s.stats", filename_prefix );
+
+  FILE *file = fopen( filename, "w" );
+  if( file == NULL ) {
+    fprintf( stderr, "Could not open stats file [%s]\n", filename );
+    return 1;
+  }
+
+  fprintf( file, "ITERATIONS %jd\n", ( intmax_t ) iterations );
+  fprintf( file, "WORK_SECONDS %d\n", work_seconds );
+  pcm.print_telemetry( file, regret_sat, avg_sat );
+  fprintf( file, "STATS_END\n" );
+
+  fclose( file );
+  return 0;
+}
+
+/* Writes the workers' sampling states to the .rng file of a checkpoint.
+ * Returns 0 on success, 1 on failure.
+ */
+int write_worker_states( const char *filename_prefix,
+			 const worker_state_t *states,
+			 const int num_threads )
+{
+  char filename[ PATH_LENGTH ];
+  snprintf( filename, PATH_LENGTH, "%s.rng", filename_prefix );
+
+  FILE *file = fopen( filename, "w" );
+  if( file == NULL ) {
+    fprintf( stderr, "Could not open rng file [%s]\n", filename );
+    return 1;
+  }
+  if( ( fwrite( &num_threads, sizeof( num_threads ), 1, file ) != 1 )
+      || ( fwrite( states, sizeof( states[ 0 ] ), num_threads, file )
+	   != ( size_t ) num_threads ) ) {
+    fprintf( stderr, "Error while writing rng file [%s]\n", filename );
+    fclose( file );
+    return 1;
+  }
+
+  fclose( file );
+  return 0;
+}
+
+/* Restores the workers' sampling states from the .rng file of a checkpoint.
+ * Returns 0 on success, 1 on failure, in which case states are unchanged.
+ */
+int read_worker_states( const char *filename_prefix,
+			worker_state_t *states,
+			const int num_threads )
+{
+  char filename[ PATH_LENGTH ];
+  snprintf( filename, PATH_LENGTH, "%s.rng", filename_prefix );
+
+  FILE *file = fopen( filename, "r" );
+  if( file == NULL ) {
+    fprintf( stderr, "Could not open rng file [%s]\n", filename );
+    return 1;
+  }
+  int file_num_threads;
+  if( fread( &file_num_threads, sizeof( file_num_threads ), 1, file ) != 1 ) {
+    fprintf( stderr, "Error while reading rng file [%s]\n", filename );
+    fclose( file );
+    return 1;
+  }
+  if( file_num_threads != num_threads ) {
+    fprintf( stderr, "rng file [%s] is for %d threads, not %d\n",
+	     filename, file_num_threads, num_threads );
+    fclose( file );
+    return 1;
+  }
+  worker_state_t file_states[ num_threads ];
+  if( fread( file_states, sizeof( file_states[ 0 ] ), num_threads, file )
+      != ( size_t ) num_threads ) {
+    fprintf( stderr, "Error while reading rng file [%s]\n", filename );
+    fclose( file );
+    return 1;
+  }
+  fclose( file );
+
+  for( int i = 0; i < num_threads; ++i ) {
+    states[ i ] = file_states[ i ];
+    states[ i ].loaded = true;
+  }
+  return 0;
+}
+
+/* Dumps regrets and avg strategy, then scans the tables for saturation and
+ * writes the stats file.  Returns 0 on success, 1 on failure.
+ */
+int write_checkpoint( const Parameters &params,
+		      const PureCfrMachine &pcm,
+		      const char *filename,
+		      const int64_t iterations,
+		      const int work_seconds,
+		      const worker_state_t *states )
+{
+  fprintf( stderr, "Checkpointing files with prefix [%s]... ", filename );
+  if( pcm.write_dump( filename ) ) {
+    fprintf( stderr, "failed!\n" );
+    return 1;
+  }
+  if( params.deterministic
+      && write_worker_states( filename, states, params.num_threads ) ) {
+    fprintf( stderr, "failed!\n" );
+    return 1;
+  }
+  fprintf( stderr, "done!\n" );
+
+  saturation_t regret_sat[ MAX_ROUNDS ];
+  saturation_t avg_sat[ MAX_ROUNDS ];
+  pcm.get_saturation( params.num_threads, regret_sat, avg_sat );
+  pcm.print_telemetry( stderr, regret_sat, avg_sat );
+  return write_stats_file( filename, iterations, work_seconds, pcm,
+			   regret_sat, avg_sat );
+}
+
+/* Checks whether a forked checkpoint has finished, waiting for it if block
+ * is set, and reports how it went
+ */
+void reap_dump_child( dump_child_t &child, const bool block )
+{
+  if( child.pid <= 0 ) {
+    return;
+  }
+
+  /* Signals such as SIGUSR1 and SIGTERM interrupt the wait, and do not mean
+   * that the child is done
+   */
+  int status;
+  pid_t pid;
+  do {
+    pid = waitpid( child.pid, &status, ( block ? 0 : WNOHANG ) );
+  } while( ( pid == -1 ) && ( errno == EINTR ) );
+  if( pid == 0 ) {
+    /* Still writing */
+    return;
+  }
+
+  struct timeval cur_time;
+  gettimeofday( &cur_time, NULL );
+  double secs = ( cur_time.tv_sec - child.start_time.tv_sec )
+    + ( cur_time.tv_usec - child.start_time.tv_usec ) / 1000000.0;
+  if( ( pid == child.pid ) && WIFEXITED( status )
+      && ( WEXITSTATUS( status ) == 0 ) ) {
+    fprintf( stderr, "Background checkpoint [%s] written in %.3lf s\n\n",
+	     child.prefix, secs );
+  } else {
+    fprintf( stderr, "Background checkpoint [%s] FAILED after %.3lf s\n\n",
+	     child.prefix, secs );
+  }
+  child.pid = 0;
+}
+
+/* Works out the CPUs that workers are placed on, worker i going to
+ * cpus[ i % num_cpus ].  Returns num_cpus, or 0 if workers are not pinned.
+ */
+int get_worker_cpus( const Parameters &params,
+		     cpu_info_t cpus[ MAX_AFFINITY_CPUS ] )
+{
+  if( params.affinity_type == AFFINITY_NONE ) {
+    return 0;
+  }
+
+  cpu_info_t topology[ MAX_AFFINITY_CPUS ];
+  int num_topology_cpus = get_cpu_topology( topology, MAX_AFFINITY_CPUS );
+
+  if( params.affinity_type == AFFINITY_LIST ) {
+    /* Use the CPUs in the order given, looking up where they are if we can */
+    for( int i = 0; i < params.num_affinity_cpus; ++i ) {
+      cpus[ i ].cpu = params.affinity_cpus[ i ];
+      cpus[ i ].package = -1;
+      cpus[ i ].core = -1;
+      cpus[ i ].core_rank = -1;
+      cpus[ i ].smt = -1;
+      for( int j = 0; j < num_topology_cpus; ++j ) {
+	if( topology[ j ].cpu == cpus[ i ].cpu ) {
+	  cpus[ i ] = topology[ j ];
+	  break;
+	}
+      }
+    }
+    return params.num_affinity_cpus;
+  }
+
+  if( num_topology_cpus == 0 ) {
+    fprintf( stderr, "WARNING: could not determine the CPU topology, "
+	     "so worker threads will not be pinned\n" );
+    return 0;
+  }
+  order_cpus( params.affinity_type, topology, num_topology_cpus );
+  memcpy( cpus, topology, num_topology_cpus * sizeof( cpus[ 0 ] ) );
+
+  return num_topology_cpus;
+}
+
+/* Pins a newly launched worker according to the placement and reports it */
+void place_worker( const int thread_num,
+		   pthread_t thread,
+		   const cpu_info_t *cpus,
+		   const int num_cpus )
+{
+  if( num_cpus == 0 ) {
+    return;
+  }
+
+  const cpu_info_t &cpu = cpus[ thread_num % num_cpus ];
+  if( pin_thread_to_cpu( thread, cpu.cpu ) ) {
+    fprintf( stderr, "WARNING: could not pin worker %d to CPU %d\n",
+	     thread_num, cpu.cpu );
+  } else {
+    fprintf( stderr, "Worker %d pinned to CPU %d (package %d, core %d, "
+	     "thread %d)\n", thread_num, cpu.cpu, cpu.package, cpu.core,
+	     cpu.smt );
+  }
+}
+
+int64_t sum_thread_iterations( const thread_stats_t *stats,
+			       const int num_threads )
+{
+  int64_t iterations = 0;
+  for( int t = 0; t < num_threads; ++t ) {
+    iterations += __atomic_load_n( &stats[ t ].iterations, __ATOMIC_RELAXED );
+  }
+  return iterations;
+}
+
+/* Prints each running thread's recent speed and the work done by all
+ * num_slots threads since the last report, so that stragglers and
+ * contention stand out.  Threads in slots num_active and above have been
+ * retired.  last_stats is updated to the current counters.
+ */
+void print_thread_stats( const int num_slots,
+			 const int num_active,
+			 const int num_rounds,
+			 const thread_stats_t *stats,
+			 thread_stats_t *last_stats,
+			 const double elapsed_seconds,
+			 const bool show_pipeline )
+{
+  thread_stats_t total;
+  init_thread_stats( total );
+  double max_speed = 0.0;
+  double min_speed = -1.0;
+  for( int t = 0; t < num_slots; ++t ) {
+    /* Take a copy so the counters are consistent across this report */
+    thread_stats_t cur;
+    cur.iterations = __atomic_load_n( &stats[ t ].iterations,
+				      __ATOMIC_RELAXED );
+    for( int r = 0; r < num_rounds; ++r ) {
+      cur.nodes_visited[ r ] = __atomic_load_n( &stats[ t ].nodes_visited[ r ],
+						__ATOMIC_RELAXED );
+    }
+    cur.terminal_evaluations
+      = __atomic_load_n( &stats[ t ].terminal_evaluations, __ATOMIC_RELAXED );
+    cur.regret_updates = __atomic_load_n( &stats[ t ].regret_updates,
+					  __ATOMIC_RELAXED );
+    cur.avg_strategy_increments
+      = __atomic_load_n( &stats[ t ].avg_strategy_increments,
+			 __ATOMIC_RELAXED );
+    cur.paused_usecs = __atomic_load_n( &stats[ t ].paused_usecs,
+					__ATOMIC_RELAXED );
+    cur.hands_dealt = __atomic_load_n( &stats[ t ].hands_dealt,
+				       __ATOMIC_RELAXED );
+
+    if( t < num_active ) {
+      double speed = ( cur.iterations - last_stats[ t ].iterations )
+	/ elapsed_seconds;
+      fprintf( stderr, "Thread %d: %jd iterations; %lg i/s recent, "
+	       "%.3lf ms paused\n", t, ( intmax_t ) cur.iterations, speed,
+	       ( cur.paused_usecs - last_stats[ t ].paused_usecs ) / 1000.0 );
+      if( speed > max_speed ) {
+	max_speed = speed;
+      }
+      if( ( min_speed < 0 ) || ( speed < min_speed ) ) {
+	min_speed = speed;
+      }
+    }
+
+    total.iterations += cur.iterations - last_stats[ t ].iterations;
+    for( int r = 0; r < num_rounds; ++r ) {
+      total.nodes_visited[ r ]
+	+= cur.nodes_visited[ r ] - last_stats[ t ].nodes_visited[ r ];
+    }
+    total.terminal_evaluations
+      += cur.terminal_evaluations - last_stats[ t ].terminal_evaluations;
+    total.regret_updates
+      += cur.regret_updates - last_stats[ t ].regret_updates;
+    total.avg_strategy_increments
+      += cur.avg_strategy_increments - last_stats[ t ].avg_strategy_increments;
+    total.hands_dealt += cur.hands_dealt - last_stats[ t ].hands_dealt;
+    last_stats[ t ] = cur;
+  }
+
+  if( num_active > 1 ) {
+    fprintf( stderr, "Slowest thread at %.1lf%% of fastest\n",
+	     ( max_speed > 0 ? 100.0 * min_speed / max_speed : 100.0 ) );
+  }
+  fprintf( stderr, "Nodes visited/s by round:" );
+  for( int r = 0; r < num_rounds; ++r ) {
+    fprintf( stderr, " %lg", total.nodes_visited[ r ] / elapsed_seconds );
+  }
+  fprintf( stderr, "\n" );
+  fprintf( stderr, "Terminal evaluations/s %lg, regret updates/s %lg, "
+	   "avg strategy increments/s %lg\n",
+	   total.terminal_evaluations / elapsed_seconds,
+	   total.regret_updates / elapsed_seconds,
+	   total.avg_strategy_increments / elapsed_seconds );
+  if( show_pipeline ) {
+    /* Hands the producers could not keep up with */
+    fprintf( stderr, "Hands dealt by workers %.2lf%%\n",
+	     ( total.iterations > 0
+	       ? 100.0 * total.hands_dealt / total.iterations : 0.0 ) );
+  }
+}
+
+/* Finishes a deterministic epoch.  Once every thread has finished its
+ * iterations, the threads merge all the update logs into the tables, each
+ * thread taking every num_threads-th round and applying the logs in thread
+ * order, so the result does not depend on timing.  Thread 0 then decides for
+ * everyone whether to pause.  Returns whether to pause.
+ */
+bool end_epoch( worker_thread_args_t *args )
+{
+  worker_control_t *control = args->control;
+  const int num_threads = args->params->num_threads;
+  const int num_rounds = args->pcm->get_num_rounds( );
+
+  pthread_barrier_wait( &control->epoch_barrier );
+  for( int r = args->thread_num; r < num_rounds; r += num_threads ) {
+    for( int t = 0; t < num_threads; ++t ) {
+      args->pcm->apply_update_log( args->update_logs[ t ], r );
+    }
+  }
+  if( args->thread_num == 0 ) {
+    /* Every thread's counters are settled while we are between barriers,
+     * and thread 0's counters are first in the array
+     */
+    int64_t run_iterations = 0;
+    for( int t = 0; t < num_threads; ++t ) {
+      run_iterations += args->stats[ t ].iterations;
+    }
+    if( run_iterations >= control->max_run_iterations ) {
+      /* Hold here until told to quit, so the run always ends at the same
+       * epoch
+       */
+      pthread_mutex_lock( &control->mutex );
+      control->hold = 1;
+      pthread_mutex_unlock( &control->mutex );
+    }
+    control->epoch_pause = ( control->hold
+			     || __atomic_load_n( &control->do_pause,
+						 __ATOMIC_ACQUIRE ) );
+  }
+  pthread_barrier_wait( &control->epoch_barrier );
+
+  update_log_t &log = args->update_logs[ args->thread_num ];
+  log.updates.clear( );
+  log.values.clear( );
+
+  return control->epoch_pause;
+}
+
+/* Returns the next hole class for stratified chance sampling.  Each pass
+ * visits all num_classes classes once in the order of a fresh random affine
+ * permutation, so every class gets its share of iterations within a pass.
+ * The offset is uniform, so each iteration on its own still samples a
+ * uniformly random class and the deal stays unbiased.
+ */
+static int next_stratum( worker_state_t &state, const int num_classes )
+{
+  if( state.stratum_count == 0 ) {
+    state.stratum_offset = rng_bounded( state.rng, num_classes );
+    /* Any stride coprime to num_classes steps through every class */
+    int stride = 1;
+    if( num_classes > 2 ) {
+      int a, b;
+      do {
+	stride = 1 + rng_bounded( state.rng, num_classes - 1 );
+	for( a = num_classes, b = stride; b != 0; ) {
+	  const int t = a % b;
+	  a = b;
+	  b = t;
+	}
+      } while( a != 1 );
+    }
+    state.stratum_stride = stride;
+  }
+
+  const int hole_class
+    = ( state.stratum_offset
+	+ ( int64_t ) state.stratum_count * state.stratum_stride ) % num_classes;
+  state.stratum_count = ( state.stratum_count + 1 ) % num_classes;
+  return hole_class;
+}
+
 void *thread_iterations( void *thread_args )
 {
   worker_thread_args_t *args = ( worker_thread_args_t * ) thread_args;
+  worker_state_t *state = args->state;
+
+  if( !state->loaded ) {
+    /* Initialize RNG using this crazy array because why not,
+     * and we ensure that the seeds are different for each thread
+     */
+    uint32_t seeds[ NUM_RNG_SEEDS ];
+    for( int i = 0; i < NUM_RNG_SEEDS; ++i ) {
+      seeds[ i ] = args->params->rng_seeds[ i ] + 1234 + 4 * args->seed_num + i;
+    }
+    rng_seed( state->rng, args->params->rng_type, seeds, NUM_RNG_SEEDS );
 
-  /* Initialize RNG using this crazy array because why not,
-   * and we ensure that the seeds are different for each thread
+    /* When chance sampling is partitioned, player 0's first hole card is
+     * forced, stepping through the deck one card per block of iterations.
+     * Threads start evenly spaced around the deck, so they mostly update
+     * different parts of the tables at any one time, while each thread on
+     * its own still forces every card equally often.
+     */
+    state->partition_index
+      = ( ( int64_t ) args->thread_num * args->pcm->get_num_deck_cards( )
+	  / args->params->num_threads ) % args->pcm->get_num_deck_cards( );
+    state->partition_count = 0;
+    state->stratum_count = 0;
+  }
+  const bool partition_chance
+    = ( args->params->chance_sampling == CHANCE_SAMPLING_PARTITIONED );
+  const bool stratified_chance
+    = ( args->params->chance_sampling == CHANCE_SAMPLING_STRATIFIED );
+  const int num_hole_classes = args->pcm->get_num_hole_classes( );
+  const bool public_chance
+    = ( args->params->chance_sampling == CHANCE_SAMPLING_PUBLIC );
+  const int num_deck_cards = args->pcm->get_num_deck_cards( );
+  const int hand_batch = args->params->hand_batch;
+
+  /* In deterministic mode, updates are logged and applied at the end of
+   * each epoch, and threads only pause between epochs
    */
-  rng_state_t rng;
-  uint32_t seeds[ NUM_RNG_SEEDS ];
-  for( int i = 0; i < NUM_RNG_SEEDS; ++i ) {
-    seeds[ i ] = args->params->rng_seeds[ i ] + 1234 + 4 * args->thread_num + i;
+  const bool deterministic = args->params->deterministic;
+  const int block_size = ( deterministic ? DETERMINISTIC_EPOCH_ITERATIONS : 1 );
+  update_log_t *log = ( deterministic
+			? &args->update_logs[ args->thread_num ] : NULL );
+
+  /* Room for a batch of hands, allocated once here rather than on the
+   * stack for every batch
+   */
+  hand_t *batch_hands = new hand_t[ hand_batch ];
+  hand_t **batch_order = new hand_t *[ hand_batch ];
+  /* Likewise the scratch space of a public chance walk */
+  public_deal_t *public_deal = NULL;
+  if( public_chance ) {
+    public_deal = new public_deal_t;
+    args->pcm->init_public_deal( *public_deal );
   }
-  init_by_array( &rng, seeds, NUM_RNG_SEEDS );
 
+  worker_control_t *control = args->control;
+  thread_stats_t *stats = args->stats;
   while( true ) {
 
-    /* Have we been told to pause? */
-    if( *args->do_pause && !( *args->do_quit ) ) {
-      /* Yes, so let's pause and wait until we are no longer told to pause */
-      args->am_paused = 1;
-      while( *args->do_pause && !( *args->do_quit ) ) {
-	sleep( 1 );
+    /* Have we been told to pause or quit? */
+    bool do_pause;
+    if( deterministic ) {
+      do_pause = end_epoch( args );
+    } else {
+      do_pause = __atomic_load_n( &control->do_pause, __ATOMIC_ACQUIRE );
+    }
+    if( do_pause ) {
+      struct timeval pause_start_time;
+      gettimeofday( &pause_start_time, NULL );
+      pthread_mutex_lock( &control->mutex );
+      control->num_paused += 1;
+      pthread_cond_signal( &control->paused_cond );
+      /* Wait until we are no longer told to pause */
+      while( ( control->do_pause || control->hold ) && !control->do_quit ) {
+	pthread_cond_wait( &control->resume_cond, &control->mutex );
+      }
+      if( control->do_quit ) {
+	/* Time to quit, and we stay counted as paused */
+	pthread_mutex_unlock( &control->mutex );
+	break;
       }
-      args->am_paused = 0;
+      control->num_paused -= 1;
+      pthread_mutex_unlock( &control->mutex );
+      struct timeval resume_time;
+      gettimeofday( &resume_time, NULL );
+      stats->paused_usecs
+	+= ( resume_time.tv_sec - pause_start_time.tv_sec ) * 1000000
+	+ ( resume_time.tv_usec - pause_start_time.tv_usec );
     }
 
-    /* Time to quit? */
-    if( *args->do_quit ) {
-      /* Yes, so quit */
-      args->am_paused = 1;
+    /* Have we been retired? */
+    if( __atomic_load_n( &args->do_stop, __ATOMIC_RELAXED ) ) {
       break;
     }
 
-    /* Run a block of iterations */
-    for( int i = 0; i < ITERATION_BLOCK_SIZE; ++i ) {
-      args->pcm->do_iteration( rng );
+    for( int i = 0; i < block_size; i += hand_batch ) {
+      int hole_class = -1;
+      if( partition_chance ) {
+	hole_class = state->partition_index;
+	state->partition_count += hand_batch;
+	if( state->partition_count >= CHANCE_PARTITION_BLOCK_SIZE ) {
+	  state->partition_count = 0;
+	  state->partition_index
+	    = ( state->partition_index + 1 ) % num_deck_cards;
+	}
+      }
+      if( public_chance ) {
+	args->pcm->do_public_iteration( *public_deal, state->rng, *stats, log );
+      } else if( stratified_chance ) {
+	/* Each hand of a batch takes the next class */
+	for( int h = 0; h < hand_batch; ++h ) {
+	  if( args->pcm->generate_hand( batch_hands[ h ], state->rng,
+					next_stratum( *state, num_hole_classes ) ) ) {
+	    fprintf( stderr, "Unable to generate hand.\n" );
+	    exit( -1 );
+	  }
+	}
+	args->pcm->do_iteration_hands( batch_hands, batch_order, hand_batch,
+				       state->rng, *stats, log );
+      } else if( args->ring != NULL ) {
+	/* Take ready hands from the producers, dealing our own if they
+	 * have fallen behind rather than waiting
+	 */
+	for( int h = 0; h < hand_batch; ++h ) {
+	  if( !pop_hand_ring( *args->ring, batch_hands[ h ] ) ) {
+	    if( args->pcm->generate_hand( batch_hands[ h ], state->rng ) ) {
+	      fprintf( stderr, "Unable to generate hand.\n" );
+	      exit( -1 );
+	    }
+	    stats->hands_dealt += 1;
+	  }
+	}
+	args->pcm->do_iteration_hands( batch_hands, batch_order, hand_batch,
+				       state->rng, *stats, log );
+      } else if( hand_batch > 1 ) {
+	args->pcm->do_iteration_batch( state->rng, *stats, batch_hands,
+				       batch_order, hand_batch, hole_class,
+				       log );
+      } else {
+	args->pcm->do_iteration( state->rng, *stats, hole_class, log );
+      }
     }
-    args->iterations += ITERATION_BLOCK_SIZE;
   }
-  
+
+  delete public_deal;
+  delete [] batch_order;
+  delete [] batch_hands;
   pthread_exit( NULL );
 }
 
+/* Deals hands into the rings of the worker slots this producer serves,
+ * slot w being served by producer w % hand_producers so that every ring has
+ * a single producer.  Rings of retired slots are left alone.
+ */
+void *thread_produce_hands( void *thread_args )
+{
+  producer_thread_args_t *args = ( producer_thread_args_t * ) thread_args;
+  const int num_producers = args->params->hand_producers;
+
+  /* Seeded apart from every worker */
+  rng_engine_t rng;
+  uint32_t seeds[ NUM_RNG_SEEDS ];
+  for( int i = 0; i < NUM_RNG_SEEDS; ++i ) {
+    seeds[ i ] = args->params->rng_seeds[ i ] + 4321
+      + 4 * args->producer_num + i;
+  }
+  rng_seed( rng, args->params->rng_type, seeds, NUM_RNG_SEEDS );
+
+  while( !__atomic_load_n( &args->control->do_quit, __ATOMIC_ACQUIRE ) ) {
+    const int num_threads = __atomic_load_n( &args->params->num_threads,
+					     __ATOMIC_ACQUIRE );
+    bool dealt = false;
+    for( int w = args->producer_num; w < num_threads; w += num_producers ) {
+      hand_t *hand;
+      while( ( hand = reserve_hand_ring( args->rings[ w ] ) ) != NULL ) {
+	if( args->pcm->generate_hand( *hand, rng ) ) {
+	  fprintf( stderr, "Unable to generate hand.\n" );
+	  exit( -1 );
+	}
+	push_hand_ring( args->rings[ w ] );
+	dealt = true;
+      }
+    }
+    if( !dealt ) {
+      /* Every ring is full, so give the workers a moment */
+      usleep( 100 );
+    }
+  }
+
+  pthread_exit( NULL );
+}
+
+/* Signals handled by the main thread.  Workers block them, so that they
+ * always interrupt the main loop's sleep and are noticed at once.
+ */
+static void get_control_signals( sigset_t &signals )
+{
+  sigemptyset( &signals );
+  sigaddset( &signals, SIGHUP );
+  sigaddset( &signals, SIGUSR1 );
+  sigaddset( &signals, SIGTERM );
+  sigaddset( &signals, SIGINT );
+}
+
+/* Allocates the buffer of every ring below num_threads that doesn't have
+ * one yet.  Exits on failure.
+ */
+void alloc_hand_rings( const Parameters &params,
+		       hand_ring_t *rings,
+		       const int num_threads )
+{
+  for( int i = 0; i < num_threads; ++i ) {
+    if( rings[ i ].hands != NULL ) {
+      continue;
+    }
+    if( init_hand_ring( rings[ i ], params.hand_ring_depth ) ) {
+      fprintf( stderr, "Couldn't allocate hand buffer for thread %d\n", i );
+      exit( -1 );
+    }
+  }
+}
+
+/* Launches the worker in the given slot.  Exits on failure. */
+void launch_worker( const int slot,
+		    const int seed_num,
+		    worker_thread_args_t *thread_args,
+		    pthread_t *threads,
+		    const cpu_info_t *cpus,
+		    const int num_cpus )
+{
+  thread_args[ slot ].seed_num = seed_num;
+  thread_args[ slot ].do_stop = 0;
+
+  /* The new thread inherits our signal mask */
+  sigset_t signals, old_signals;
+  get_control_signals( signals );
+  pthread_sigmask( SIG_BLOCK, &signals, &old_signals );
+  int status = pthread_create( &threads[ slot ],
+			       &thread_attributes,
+			       thread_iterations,
+			       &thread_args[ slot ] );
+  pthread_sigmask( SIG_SETMASK, &old_signals, NULL );
+  if( status ) {
+    fprintf( stderr, "Couldn't launch worker thread %d, status = %d\n",
+	     slot, status );
+    exit( -1 );
+  }
+  place_worker( slot, threads[ slot ], cpus, num_cpus );
+}
+
+/* Set by SIGHUP to force the thread control file to be read again */
+static volatile sig_atomic_t reread_thread_control = 0;
+/* Set by SIGUSR1 to write a checkpoint now */
+static volatile sig_atomic_t checkpoint_requested = 0;
+/* Set by SIGTERM or SIGINT to write a checkpoint and quit */
+static volatile sig_atomic_t quit_requested = 0;
+
+static void handle_signal( int signum )
+{
+  switch( signum ) {
+  case SIGHUP:
+    reread_thread_control = 1;
+    break;
+  case SIGUSR1:
+    checkpoint_requested = 1;
+    break;
+  default:
+    quit_requested = 1;
+    break;
+  }
+}
+
+/* Installs the handlers for the control signals.  SIGTERM and SIGINT
+ * revert to their default action once caught, so a second one kills us
+ * straight away if the final checkpoint is taking too long.
+ */
+void install_signal_handlers( const Parameters &params )
+{
+  struct sigaction action;
+  memset( &action, 0, sizeof( action ) );
+  action.sa_handler = handle_signal;
+  sigemptyset( &action.sa_mask );
+  sigaction( SIGUSR1, &action, NULL );
+  if( params.thread_control ) {
+    sigaction( SIGHUP, &action, NULL );
+  }
+  action.sa_flags = SA_RESETHAND;
+  sigaction( SIGTERM, &action, NULL );
+  sigaction( SIGINT, &action, NULL );
+}
+
+/* Reads the number of threads wanted from the thread control file if it
+ * has been modified since last_mtime, or if SIGHUP was received.
+ * Returns the number of threads, or 0 if it is unchanged or unreadable.
+ */
+int read_thread_control( const Parameters &params, time_t &last_mtime )
+{
+  struct stat file_stat;
+  if( stat( params.thread_control_file, &file_stat ) ) {
+    /* No control file, so nothing to change */
+    return 0;
+  }
+  if( ( file_stat.st_mtime == last_mtime ) && !reread_thread_control ) {
+    return 0;
+  }
+  last_mtime = file_stat.st_mtime;
+  reread_thread_control = 0;
+
+  FILE *file = fopen( params.thread_control_file, "r" );
+  if( file == NULL ) {
+    fprintf( stderr, "WARNING: could not open thread control file [%s]\n",
+	     params.thread_control_file );
+    return 0;
+  }
+  int num_threads;
+  int num_read = fscanf( file, "%d", &num_threads );
+  fclose( file );
+  if( ( num_read < 1 ) || ( num_threads < 1 )
+      || ( num_threads > MAX_WORKER_THREADS ) ) {
+    fprintf( stderr, "WARNING: thread control file [%s] must hold a number of "
+	     "threads between 1 and %d\n", params.thread_control_file,
+	     MAX_WORKER_THREADS );
+    return 0;
+  }
+
+  return num_threads;
+}
+
 void run_iterations( Parameters &params, PureCfrMachine &pcm )
 {
-  int do_pause = 0;
-  int do_quit = 0;
+  worker_control_t control;
+  pthread_mutex_init( &control.mutex, NULL );
+  pthread_cond_init( &control.paused_cond, NULL );
+  pthread_cond_init( &control.resume_cond, NULL );
+  control.do_pause = 0;
+  control.do_quit = 0;
+  control.num_paused = 0;
+  control.epoch_pause = 0;
+  control.hold = 0;
 
   /* Record the time we started */
   struct timeval absolute_start_time;
@@ -155,32 +916,98 @@ void run_iterations( Parameters &params, PureCfrMachine &pcm )
     }
     fprintf( stderr, "done!\n\n" );
   }
+  control.max_run_iterations = params.max_iterations - initial_counts.iterations;
 
   /* Set up threads */
-  worker_thread_args_t thread_args[ params.num_threads ];
-  pthread_t threads[ params.num_threads ];
-  for( int i = 0; i < params.num_threads; ++i ) {
+  /* Slots are set up for the most threads we could ever run, so that the
+   * pool can grow later.  A slot keeps its counters when its worker is
+   * retired and carries on from them if a worker is launched there again.
+   */
+  worker_thread_args_t thread_args[ MAX_WORKER_THREADS ];
+  thread_stats_t thread_stats[ MAX_WORKER_THREADS ];
+  thread_stats_t last_thread_stats[ MAX_WORKER_THREADS ];
+  worker_state_t thread_states[ MAX_WORKER_THREADS ];
+  update_log_t update_logs[ MAX_WORKER_THREADS ];
+  pthread_t threads[ MAX_WORKER_THREADS ];
+  for( int i = 0; i < MAX_WORKER_THREADS; ++i ) {
+    init_thread_stats( thread_stats[ i ] );
+    init_thread_stats( last_thread_stats[ i ] );
+    thread_states[ i ].loaded = false;
     thread_args[ i ].thread_num = i;
     thread_args[ i ].params = &params;
     thread_args[ i ].pcm = &pcm;
-    thread_args[ i ].iterations = 0;
-    thread_args[ i ].do_pause = &do_pause;
-    thread_args[ i ].am_paused = 0;
-    thread_args[ i ].do_quit = &do_quit;
+    thread_args[ i ].stats = &thread_stats[ i ];
+    thread_args[ i ].state = &thread_states[ i ];
+    thread_args[ i ].update_logs = update_logs;
+    thread_args[ i ].control = &control;
+    thread_args[ i ].ring = NULL;
+  }
+
+  /* Each worker slot gets a ring of hands when producers deal for them.
+   * A slot's buffer is only allocated once a worker is launched there.
+   */
+  hand_ring_t *rings = NULL;
+  if( params.hand_producers > 0 ) {
+    rings = new hand_ring_t[ MAX_WORKER_THREADS ];
+    for( int i = 0; i < MAX_WORKER_THREADS; ++i ) {
+      rings[ i ].head = 0;
+      rings[ i ].tail = 0;
+      rings[ i ].hands = NULL;
+      rings[ i ].depth = 0;
+      thread_args[ i ].ring = &rings[ i ];
+    }
+    alloc_hand_rings( params, rings, params.num_threads );
+  }
+
+  if( params.deterministic ) {
+    pthread_barrier_init( &control.epoch_barrier, NULL, params.num_threads );
+    if( params.load_dump ) {
+      /* Carry on with the same random numbers for a bit-exact resume */
+      if( read_worker_states( params.load_dump_prefix, thread_states,
+			      params.num_threads ) ) {
+	fprintf( stderr, "WARNING: reseeding the threads, so this run will "
+		 "not reproduce an uninterrupted one\n" );
+      }
+    }
   }
 
+  /* Work out where the threads will run */
+  cpu_info_t worker_cpus[ MAX_AFFINITY_CPUS ];
+  int num_worker_cpus = get_worker_cpus( params, worker_cpus );
+
+  /* Checkpoint on SIGUSR1, checkpoint and quit on SIGTERM or SIGINT */
+  install_signal_handlers( params );
+
   /* Launch threads */
   for( int i = 0; i < params.num_threads; ++i ) {
-    int status = pthread_create( &threads[ i ],
-				 &thread_attributes,
-				 thread_iterations,
-				 &thread_args[ i ] );
+    launch_worker( i, i, thread_args, threads, worker_cpus, num_worker_cpus );
+  }
+  producer_thread_args_t producer_args[ MAX_WORKER_THREADS ];
+  pthread_t producers[ MAX_WORKER_THREADS ];
+  for( int p = 0; p < params.hand_producers; ++p ) {
+    producer_args[ p ].producer_num = p;
+    producer_args[ p ].params = &params;
+    producer_args[ p ].pcm = &pcm;
+    producer_args[ p ].rings = rings;
+    producer_args[ p ].control = &control;
+    sigset_t signals, old_signals;
+    get_control_signals( signals );
+    pthread_sigmask( SIG_BLOCK, &signals, &old_signals );
+    int status = pthread_create( &producers[ p ], &thread_attributes,
+				 thread_produce_hands, &producer_args[ p ] );
+    pthread_sigmask( SIG_SETMASK, &old_signals, NULL );
     if( status ) {
-      fprintf( stderr, "Couldn't launch worker thread %d, status = %d\n",
-	       i, status );
+      fprintf( stderr, "Couldn't create producer thread %d, status = %d\n",
+	       p, status );
       exit( -1 );
     }
   }
+  /* Slots ever used, and the seed number for the next worker launched */
+  int num_slots_used = params.num_threads;
+  int next_seed_num = params.num_threads;
+
+  /* Watch the thread control file for changes to the number of threads */
+  time_t thread_control_mtime = 0;
   
   /* Get the current time */
   struct timeval start_time;
@@ -198,31 +1025,95 @@ void run_iterations( Parameters &params, PureCfrMachine &pcm )
       + params.dump_timer.seconds_add;
   }
 
-  /* Variable to keep track of how much time is spent dumping files to disk */
-  int dumping_secs = 0;
+  /* Variable to keep track of how much time the threads spend paused */
+  int64_t paused_usecs = 0;
 
+  /* Forked checkpoint currently being written, if any */
+  dump_child_t dump_child;
+  dump_child.pid = 0;
+
+  bool do_quit = false;
   while( !do_quit ) {
     
-    /* Sleep a second so that we don't busy-wait */
+    /* Sleep a second so that we don't busy-wait.  A signal cuts this
+     * short.
+     */
     sleep( 1 );
 
+    /* Has a background checkpoint finished? */
+    reap_dump_child( dump_child, false );
+
+    /* Have we been asked to change the number of threads? */
+    int new_num_threads = 0;
+    if( params.thread_control ) {
+      new_num_threads = read_thread_control( params, thread_control_mtime );
+    }
+    if( ( new_num_threads > 0 ) && ( new_num_threads != params.num_threads ) ) {
+      fprintf( stderr, "Resizing worker pool from %d to %d threads\n",
+	       params.num_threads, new_num_threads );
+      /* Retire workers from the top slots down, or launch new ones above,
+       * each new worker getting a seed no earlier worker has used
+       */
+      for( int i = new_num_threads; i < params.num_threads; ++i ) {
+	__atomic_store_n( &thread_args[ i ].do_stop, 1, __ATOMIC_RELAXED );
+      }
+      for( int i = new_num_threads; i < params.num_threads; ++i ) {
+	int status = pthread_join( threads[ i ], NULL );
+	if( status ) {
+	  fprintf( stderr, "Couldn't join to thread %d, status = %d\n",
+		   i, status );
+	}
+      }
+      int old_num_threads = params.num_threads;
+      if( rings != NULL ) {
+	alloc_hand_rings( params, rings, new_num_threads );
+      }
+      /* Producers read this to see which rings to fill, so the new rings
+       * must be visible to them first
+       */
+      __atomic_store_n( &params.num_threads, new_num_threads,
+			__ATOMIC_RELEASE );
+      for( int i = old_num_threads; i < new_num_threads; ++i ) {
+	launch_worker( i, next_seed_num, thread_args, threads, worker_cpus,
+		       num_worker_cpus );
+	next_seed_num += 1;
+      }
+      if( num_slots_used < new_num_threads ) {
+	num_slots_used = new_num_threads;
+      }
+      fprintf( stderr, "\n" );
+    }
+
     /* Get the current time */
     struct timeval cur_time;
     gettimeofday( &cur_time, NULL );
 
+    /* Get the number of iterations completed */
+    int64_t iterations_complete = initial_counts.iterations
+      + sum_thread_iterations( thread_stats, num_slots_used );
+
     /* Is it time to quit? */
     do_quit = ( cur_time.tv_sec - absolute_start_time.tv_sec
 		>= params.max_walltime_seconds );
-    
-    /* Get the number of iterations completed */
-    int64_t iterations_complete = initial_counts.iterations;
-    for( int t = 0; t < params.num_threads; ++t ) {
-      iterations_complete += thread_args[ t ].iterations;
+    if( iterations_complete >= params.max_iterations ) {
+      do_quit = true;
+    }
+    if( quit_requested ) {
+      fprintf( stderr, "Termination requested; checkpointing and quitting\n" );
+      do_quit = true;
     }
 
+    /* Has a checkpoint been asked for? */
+    bool do_checkpoint = false;
+    if( checkpoint_requested ) {
+      checkpoint_requested = 0;
+      fprintf( stderr, "Checkpoint requested\n" );
+      do_checkpoint = true;
+    }
+    
     /* Get the total amount of time we've been doing work */
     int work_seconds = initial_counts.seconds + cur_time.tv_sec
-      - start_time.tv_sec - dumping_secs;
+      - start_time.tv_sec - paused_usecs / 1000000;
 
     /* Is it time to print status? */
     if( cur_time.tv_sec - last_status_counter.seconds
@@ -248,6 +1139,14 @@ void run_iterations( Parameters &params, PureCfrMachine &pcm )
 			      ( cur_time.tv_sec - absolute_start_time.tv_sec ),
 			      temp, 100 );
       fprintf( stderr, "%s until quit\n", temp );
+      print_thread_stats( num_slots_used, params.num_threads,
+			  pcm.get_num_rounds( ), thread_stats,
+			  last_thread_stats,
+			  ( last_status_counter.seconds > 0
+			    ? cur_time.tv_sec - last_status_counter.seconds
+			    : cur_time.tv_sec - start_time.tv_sec ),
+			  params.hand_producers > 0 );
+      pcm.print_telemetry( stderr );
 
       /* Update status counter */
       last_status_counter.seconds = cur_time.tv_sec;
@@ -256,54 +1155,98 @@ void run_iterations( Parameters &params, PureCfrMachine &pcm )
     }
 
     /* Is it time to checkpoint? */
-    if( ( work_seconds >= next_dump_seconds ) || do_quit ) {
+    if( ( work_seconds >= next_dump_seconds ) || do_quit || do_checkpoint ) {
       /* Yes, dump a checkpoint */
 
+      /* Only one checkpoint is written at a time.  Wait for any previous one
+       * while the threads keep working.
+       */
+      if( dump_child.pid > 0 ) {
+	fprintf( stderr, "Waiting for previous checkpoint to finish\n" );
+	reap_dump_child( dump_child, true );
+      }
+
       /* First, pause the threads */
-      do_pause = 1;
+      struct timeval pause_start_time;
+      gettimeofday( &pause_start_time, NULL );
       fprintf( stderr, "Pause initiated to begin dump\n" );
-      fprintf( stderr, "Number of threads paused:" );
-      int num_paused;
-      do {
-	sleep( 1 );
-	num_paused = 0;
-	for( int t = 0; t < params.num_threads; ++t ) {
-	  num_paused += thread_args[ t ].am_paused;
-	}
-	fprintf( stderr, " %d", num_paused );
-      } while( num_paused < params.num_threads );
-      fprintf( stderr, "\n" );
+      pthread_mutex_lock( &control.mutex );
+      __atomic_store_n( &control.do_pause, 1, __ATOMIC_RELEASE );
+      while( control.num_paused < params.num_threads ) {
+	pthread_cond_wait( &control.paused_cond, &control.mutex );
+      }
+      pthread_mutex_unlock( &control.mutex );
+      struct timeval paused_time;
+      gettimeofday( &paused_time, NULL );
+      fprintf( stderr, "All %d threads paused in %.3lf ms\n",
+	       params.num_threads,
+	       ( ( paused_time.tv_sec - pause_start_time.tv_sec ) * 1000000
+		 + ( paused_time.tv_usec - pause_start_time.tv_usec ) )
+	       / 1000.0 );
 
       /* Record time dump started */
       struct timeval dump_start_time;
       gettimeofday( &dump_start_time, NULL );
 
       /* Build the filename */
-      iterations_complete = initial_counts.iterations;
-      for( int t = 0; t < params.num_threads; ++t ) {
-	iterations_complete += thread_args[ t ].iterations;
-      }
+      iterations_complete = initial_counts.iterations
+	+ sum_thread_iterations( thread_stats, num_slots_used );
       char filename[ PATH_LENGTH ];
       char iterations_str[ PATH_LENGTH ];
       int64tostr_units( iterations_complete, iterations_str, PATH_LENGTH );
       work_seconds = initial_counts.seconds + cur_time.tv_sec
-	- start_time.tv_sec - dumping_secs;
+	- start_time.tv_sec - paused_usecs / 1000000;
       snprintf( filename, PATH_LENGTH, "%s.iter-%s.secs-%d", params.output_prefix,
 		iterations_str, work_seconds );
       print_player_file( params, filename );
 
-      fprintf( stderr, "Checkpointing files with prefix [%s]... ", filename );
-      pcm.write_dump( filename );
-      fprintf( stderr, "done!\n" );
-
-      /* Unpause the threads */
-      do_pause = 0;
-      fprintf( stderr, "Pause released\n\n" );
+      /* When forking, the child gets a consistent copy-on-write image of
+       * the tables as they are now, and the threads can resume at once.
+       * There is no point forking for the final checkpoint.
+       */
+      pid_t pid = -1;
+      if( ( params.checkpoint_mode == CHECKPOINT_FORK ) && !do_quit ) {
+	pid = fork( );
+	if( pid == 0 ) {
+	  /* Child: write the snapshot and leave without running destructors */
+	  _exit( write_checkpoint( params, pcm, filename, iterations_complete,
+				   work_seconds, thread_states ) );
+	} else if( pid < 0 ) {
+	  perror( "Could not fork checkpoint, writing it in the foreground" );
+	} else {
+	  dump_child.pid = pid;
+	  snprintf( dump_child.prefix, PATH_LENGTH, "%s", filename );
+	  gettimeofday( &dump_child.start_time, NULL );
+	  fprintf( stderr, "Checkpoint [%s] forked to process %d\n",
+		   filename, ( int ) pid );
+	}
+      }
+      if( pid <= 0 ) {
+	write_checkpoint( params, pcm, filename, iterations_complete,
+			  work_seconds, thread_states );
+      }
 
-      /* How much time was spent dumping? */
+      /* Unpause the threads, unless we are about to quit */
       struct timeval dump_end_time;
       gettimeofday( &dump_end_time, NULL );
-      dumping_secs += dump_end_time.tv_sec - dump_start_time.tv_sec;
+      if( !do_quit ) {
+	pthread_mutex_lock( &control.mutex );
+	__atomic_store_n( &control.do_pause, 0, __ATOMIC_RELEASE );
+	pthread_cond_broadcast( &control.resume_cond );
+	pthread_mutex_unlock( &control.mutex );
+	fprintf( stderr, "Pause released\n" );
+      }
+
+      /* How much time was spent paused? */
+      int64_t pause_usecs
+	= ( dump_end_time.tv_sec - pause_start_time.tv_sec ) * 1000000
+	+ ( dump_end_time.tv_usec - pause_start_time.tv_usec );
+      paused_usecs += pause_usecs;
+      fprintf( stderr, "Threads paused for %.3lf ms (%s took %.3lf ms)\n\n",
+	       pause_usecs / 1000.0, ( pid > 0 ? "fork" : "dump" ),
+	       ( ( dump_end_time.tv_sec - dump_start_time.tv_sec ) * 1000000
+		 + ( dump_end_time.tv_usec - dump_start_time.tv_usec ) )
+	       / 1000.0 );
 
       /* Update the next dump */
       while( work_seconds >= next_dump_seconds ) {
@@ -313,7 +1256,15 @@ void run_iterations( Parameters &params, PureCfrMachine &pcm )
     }
   }
 
-  /* Wait for threads to return */
+  /* Make sure no checkpoint is left half written */
+  reap_dump_child( dump_child, true );
+
+  /* Tell the threads to quit, then wait for them to return */
+  pthread_mutex_lock( &control.mutex );
+  control.do_quit = 1;
+  __atomic_store_n( &control.do_pause, 1, __ATOMIC_RELEASE );
+  pthread_cond_broadcast( &control.resume_cond );
+  pthread_mutex_unlock( &control.mutex );
   for( int i = 0; i < params.num_threads; ++i ) {
     fprintf( stderr, "Waiting for thread %d to finish\n", i );
     int status = pthread_join( threads[ i ], NULL );
@@ -321,10 +1272,106 @@ void run_iterations( Parameters &params, PureCfrMachine &pcm )
       fprintf( stderr, "Couldn't join to thread %d, status = %d\n", i, status );
     }
   }
+  for( int p = 0; p < params.hand_producers; ++p ) {
+    int status = pthread_join( producers[ p ], NULL );
+    if( status ) {
+      fprintf( stderr, "Couldn't join to producer thread %d, status = %d\n",
+	       p, status );
+    }
+  }
+  if( rings != NULL ) {
+    for( int i = 0; i < MAX_WORKER_THREADS; ++i ) {
+      free_hand_ring( rings[ i ] );
+    }
+    delete [] rings;
+  }
+
+  pthread_cond_destroy( &control.resume_cond );
+  pthread_cond_destroy( &control.paused_cond );
+  pthread_mutex_destroy( &control.mutex );
+  if( params.deterministic ) {
+    pthread_barrier_destroy( &control.epoch_barrier );
+  }
 
   fprintf( stderr, "\nAll Dun :)\n" );
 }
 
+/* Builds the abstract game and reports the size of the regret and
+ * avg strategy tables that a run with these parameters would allocate,
+ * without allocating them.
+ */
+void print_memory_plan( const Parameters &params )
+{
+  AbstractGame ag( params );
+
+  size_t num_entries_per_bucket[ MAX_ROUNDS ];
+  size_t total_num_entries[ MAX_ROUNDS ];
+  size_t num_choice_nodes[ MAX_ROUNDS ];
+  size_t num_info_sets[ MAX_ROUNDS ];
+  size_t num_terminal_nodes = 0;
+  int max_num_choices = 0;
+  memset( num_entries_per_bucket, 0,
+	  MAX_ROUNDS * sizeof( num_entries_per_bucket[ 0 ] ) );
+  memset( total_num_entries, 0, MAX_ROUNDS * sizeof( total_num_entries[ 0 ] ) );
+  memset( num_choice_nodes, 0, MAX_ROUNDS * sizeof( num_choice_nodes[ 0 ] ) );
+  memset( num_info_sets, 0, MAX_ROUNDS * sizeof( num_info_sets[ 0 ] ) );
+  ag.count_entries( num_entries_per_bucket, total_num_entries );
+  ag.count_nodes( num_choice_nodes, num_info_sets, num_terminal_nodes,
+		  max_num_choices );
+
+  fprintf( stderr, "Memory plan:\n" );
+  fprintf( stderr, "%5s %12s %14s %14s %16s %7s %12s %7s %12s\n",
+	   "round", "nodes", "info-sets", "entries/bkt", "entries",
+	   "regret", "bytes", "avg", "bytes" );
+  uint64_t regret_bytes = 0;
+  uint64_t avg_bytes = 0;
+  size_t total_choice_nodes = 0;
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    uint64_t round_regret_bytes = ( uint64_t ) total_num_entries[ r ]
+      * entry_type_size( params.regret_types[ r ] );
+    uint64_t round_avg_bytes = 0;
+    if( params.do_average ) {
+      round_avg_bytes = ( uint64_t ) total_num_entries[ r ]
+	* entry_type_size( params.avg_strategy_types[ r ] );
+    }
+    regret_bytes += round_regret_bytes;
+    avg_bytes += round_avg_bytes;
+    total_choice_nodes += num_choice_nodes[ r ];
+
+    char regret_str[ 100 ];
+    char avg_str[ 100 ];
+    bytes_to_string( round_regret_bytes, regret_str, 100 );
+    bytes_to_string( round_avg_bytes, avg_str, 100 );
+    fprintf( stderr, "%5d %12zu %14zu %14zu %16zu %7s %12s %7s %12s\n",
+	     r, num_choice_nodes[ r ], num_info_sets[ r ],
+	     num_entries_per_bucket[ r ], total_num_entries[ r ],
+	     entry_type_to_str[ params.regret_types[ r ] ], regret_str,
+	     ( params.do_average
+	       ? entry_type_to_str[ params.avg_strategy_types[ r ] ] : "-" ),
+	     avg_str );
+  }
+
+  char temp[ 100 ];
+  uint64_t tree_bytes;
+  if( ag.game->numPlayers == 2 ) {
+    tree_bytes = total_choice_nodes * sizeof( InfoSetNode2p )
+      + num_terminal_nodes * sizeof( TerminalNode2p );
+  } else {
+    tree_bytes = total_choice_nodes * sizeof( InfoSetNodeNp )
+      + num_terminal_nodes * sizeof( TerminalNodeNp );
+  }
+  bytes_to_string( tree_bytes, temp, 100 );
+  fprintf( stderr, "Betting tree: %zu choice nodes, %zu terminal nodes, "
+	   "at most %d choices per node, %s\n", total_choice_nodes,
+	   num_terminal_nodes, max_num_choices, temp );
+  bytes_to_string( regret_bytes, temp, 100 );
+  fprintf( stderr, "Regrets: %s\n", temp );
+  bytes_to_string( avg_bytes, temp, 100 );
+  fprintf( stderr, "Avg strategy: %s\n", temp );
+  bytes_to_string( regret_bytes + avg_bytes, temp, 100 );
+  fprintf( stderr, "Total: %s\n", temp );
+}
+
 int main( const int argc, const char *argv[] )
 {
   /* Parse command line */
@@ -336,6 +1383,12 @@ int main( const int argc, const char *argv[] )
     params.print_params( stderr );
   }
 
+  if( params.plan_only ) {
+    /* Report memory requirements without allocating anything */
+    print_memory_plan( params );
+    return 0;
+  }
+
   /* Initialize regrets and things before starting Pure CFR iterations */
   fprintf( stderr, "Initializing Pure CFR machine... " );
   PureCfrMachine pcm( params );
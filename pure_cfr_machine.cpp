@@ -14,6 +14,8 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <limits.h>
+#include <pthread.h>
+#include <algorithm>
 
 /* C project_acpc_poker includes */
 extern "C" {
@@ -22,8 +24,34 @@ extern "C" {
 /* Pure CFR includes */
 #include "pure_cfr_machine.hpp"
 
+/* Finds the most choice nodes on any path below node, counting node at
+ * the given depth, and the most choices at any of them
+ */
+static void get_walk_size( const BettingNode *node,
+			   const int depth,
+			   int &max_depth,
+			   int &max_choices )
+{
+  const BettingNode *child = node->get_child( );
+  if( child == NULL ) {
+    return;
+  }
+
+  if( depth + 1 > max_depth ) {
+    max_depth = depth + 1;
+  }
+  if( node->get_num_choices( ) > max_choices ) {
+    max_choices = node->get_num_choices( );
+  }
+  while( child != NULL ) {
+    get_walk_size( child, depth + 1, max_depth, max_choices );
+    child = child->get_sibling( );
+  }
+}
+
 PureCfrMachine::PureCfrMachine( const Parameters &params )
   : ag( params ),
+    evaluator( ag.game ),
     do_average( params.do_average )
 {
   /* Check for problems */
@@ -33,6 +61,8 @@ PureCfrMachine::PureCfrMachine( const Parameters &params )
     exit( -1 );
   }
 
+  init_deck( ag.game, deck );
+
   /* count up the number of entries required per round to store regret,
    * avg_strategy
    */
@@ -47,48 +77,19 @@ PureCfrMachine::PureCfrMachine( const Parameters &params )
   for( int r = 0; r < MAX_ROUNDS; ++r ) {
     if( r < ag.game->numRounds ) {
 
-      /* Regret */
-      switch( REGRET_TYPES[ r ] ) {
-      case TYPE_INT:
-	regrets[ r ] = new Entries_der<int>( num_entries_per_bucket[ r ],
-					     total_num_entries[ r ] );
-	break;
-
-      default:
-	fprintf( stderr, "unrecognized regret type [%d], "
-		 "note that type must be signed\n", REGRET_TYPES[ r ] );
+      /* Regret, of a signed type checked by Parameters::parse */
+      regrets[ r ] = new_entries( params.regret_types[ r ],
+				  num_entries_per_bucket[ r ],
+				  total_num_entries[ r ] );
+      if( regrets[ r ] == NULL ) {
 	exit( -1 );
       }
-	  	  
+
       if( do_average ) {
-	switch( AVG_STRATEGY_TYPES[ r ] ) {
-	case TYPE_UINT8_T:
-	  avg_strategy[ r ]
-	    = new Entries_der<uint8_t>( num_entries_per_bucket[ r ],
-					total_num_entries[ r ] );
-	  break;
-
-	case TYPE_INT:
-	  avg_strategy[ r ]
-	    = new Entries_der<int>( num_entries_per_bucket[ r ],
-				    total_num_entries[ r ] );
-	  break;
-	  
-	case TYPE_UINT32_T:
-	  avg_strategy[ r ]
-	    = new Entries_der<uint32_t>( num_entries_per_bucket[ r ],
-					 total_num_entries[ r ] );
-	  break;
-		
-	case TYPE_UINT64_T:
-	  avg_strategy[ r ]
-	    = new Entries_der<uint64_t>( num_entries_per_bucket[ r ],
+	avg_strategy[ r ] = new_entries( params.avg_strategy_types[ r ],
+					 num_entries_per_bucket[ r ],
 					 total_num_entries[ r ] );
-	  break;
-	  
-	default:
-	  fprintf( stderr, "unrecognized avg strategy type [%d]\n",
-		   AVG_STRATEGY_TYPES[ r ] );
+	if( avg_strategy[ r ] == NULL ) {
 	  exit( -1 );
 	}
       } else {
@@ -101,10 +102,61 @@ PureCfrMachine::PureCfrMachine( const Parameters &params )
       avg_strategy[ r ] = NULL;
     }
   }
+
+  num_class_cards
+    = ( params.chance_sampling == CHANCE_SAMPLING_STRATIFIED
+	? ag.game->numHoleCards : 1 );
+
+  /* Deal every hand now if there are few enough */
+  deal_table = NULL;
+  num_table_deals = 0;
+  if( params.max_table_deals > 0 ) {
+    build_deal_table( params.max_table_deals );
+  }
+
+  /* List every private hand for public chance sampling */
+  private_hands = NULL;
+  num_private_hands = 0;
+  max_public_depth = 0;
+  max_public_choices = 0;
+  if( params.chance_sampling == CHANCE_SAMPLING_PUBLIC ) {
+    if( ( ag.game->numPlayers != 2 ) || ( ag.game->numHoleCards > 2 )
+	|| !ag.card_abs->can_precompute_buckets( ) ) {
+      fprintf( stderr, "--chance-sampling=%s needs a 2 player game with at "
+	       "most 2 hole cards and a card abstraction that can precompute "
+	       "buckets\n", chance_sampling_to_str[ CHANCE_SAMPLING_PUBLIC ] );
+      exit( -1 );
+    }
+    const int num_deck_cards = get_num_deck_cards( );
+    num_private_hands = num_deck_cards;
+    if( ag.game->numHoleCards == 2 ) {
+      num_private_hands *= num_deck_cards - 1;
+    }
+    private_hands = new uint8_t[ num_private_hands * MAX_HOLE_CARDS ];
+    int i = 0;
+    for( int a = 0; a < num_deck_cards; ++a ) {
+      if( ag.game->numHoleCards == 1 ) {
+	private_hands[ i * MAX_HOLE_CARDS ] = get_deck_card( a );
+	++i;
+	continue;
+      }
+      for( int b = 0; b < num_deck_cards; ++b ) {
+	if( b != a ) {
+	  private_hands[ i * MAX_HOLE_CARDS ] = get_deck_card( a );
+	  private_hands[ i * MAX_HOLE_CARDS + 1 ] = get_deck_card( b );
+	  ++i;
+	}
+      }
+    }
+    get_walk_size( ag.betting_tree_root, 0, max_public_depth,
+		   max_public_choices );
+  }
 }
 
 PureCfrMachine::~PureCfrMachine( )
 {
+  delete [] deal_table;
+  delete [] private_hands;
   for( int r = 0; r < MAX_ROUNDS; ++r ) {
     if( regrets[ r ] != NULL ) {
       delete regrets[ r ];
@@ -117,15 +169,283 @@ PureCfrMachine::~PureCfrMachine( )
   }
 }
 
-void PureCfrMachine::do_iteration( rng_state_t &rng )
+void init_thread_stats( thread_stats_t &stats )
+{
+  memset( &stats, 0, sizeof( stats ) );
+}
+
+void PureCfrMachine::do_iteration( rng_engine_t &rng, thread_stats_t &stats,
+				   const int hole_class,
+				   update_log_t *log )
 {
   hand_t hand;
-  if( generate_hand( hand, rng ) ) {
+  if( generate_hand( hand, rng, hole_class ) ) {
     fprintf( stderr, "Unable to generate hand.\n" );
     exit( -1 );
   }
   for( int p = 0; p < ag.game->numPlayers; ++p ) {
-    walk_pure_cfr( p, ag.betting_tree_root, hand, rng );
+    walk_pure_cfr( p, ag.betting_tree_root, hand, rng, stats, log );
+  }
+  stats.iterations += 1;
+}
+
+/* Orders hands by preflop buckets, then by each later round's buckets */
+static int compare_hand_buckets( const void *a, const void *b )
+{
+  const hand_t *hand_a = *( const hand_t * const * ) a;
+  const hand_t *hand_b = *( const hand_t * const * ) b;
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    for( int p = 0; p < MAX_PURE_CFR_PLAYERS; ++p ) {
+      if( hand_a->precomputed_buckets[ p ][ r ]
+	  != hand_b->precomputed_buckets[ p ][ r ] ) {
+	return ( hand_a->precomputed_buckets[ p ][ r ]
+		 < hand_b->precomputed_buckets[ p ][ r ] ? -1 : 1 );
+      }
+    }
+  }
+  return 0;
+}
+
+void PureCfrMachine::do_iteration_batch( rng_engine_t &rng,
+					 thread_stats_t &stats,
+					 hand_t *hands,
+					 hand_t **order,
+					 const int num_hands,
+					 const int hole_class,
+					 update_log_t *log )
+{
+  for( int i = 0; i < num_hands; ++i ) {
+    if( generate_hand( hands[ i ], rng, hole_class ) ) {
+      fprintf( stderr, "Unable to generate hand.\n" );
+      exit( -1 );
+    }
+  }
+
+  do_iteration_hands( hands, order, num_hands, rng, stats, log );
+}
+
+void PureCfrMachine::do_iteration_hands( hand_t *hands,
+					 hand_t **order,
+					 const int num_hands,
+					 rng_engine_t &rng,
+					 thread_stats_t &stats,
+					 update_log_t *log )
+{
+  for( int i = 0; i < num_hands; ++i ) {
+    order[ i ] = &hands[ i ];
+  }
+
+  /* Without precomputed buckets there is nothing to sort on */
+  if( ( num_hands > 1 ) && ag.card_abs->can_precompute_buckets( ) ) {
+    qsort( order, num_hands, sizeof( order[ 0 ] ), compare_hand_buckets );
+  }
+
+  for( int i = 0; i < num_hands; ++i ) {
+    for( int p = 0; p < ag.game->numPlayers; ++p ) {
+      walk_pure_cfr( p, ag.betting_tree_root, *order[ i ], rng, stats, log );
+    }
+    stats.iterations += 1;
+  }
+}
+
+void PureCfrMachine::init_public_deal( public_deal_t &deal ) const
+{
+  deal.valid.assign( num_private_hands, 0 );
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    deal.buckets[ r ].assign( num_private_hands, 0 );
+    deal.bucket_order[ r ].reserve( num_private_hands );
+  }
+  deal.ranks.assign( num_private_hands, 0 );
+  deal.rank_order.reserve( num_private_hands );
+  memset( &deal.counts, 0, sizeof( deal.counts ) );
+  deal.choices.assign( ( size_t ) max_public_depth * num_private_hands, 0 );
+  deal.reach.assign( ( size_t ) max_public_depth * num_private_hands, 0 );
+  deal.values.assign( ( size_t ) ( max_public_depth + 1 ) * max_public_choices
+		      * num_private_hands, 0 );
+}
+
+void PureCfrMachine::do_public_iteration( public_deal_t &deal,
+					  rng_engine_t &rng,
+					  thread_stats_t &stats,
+					  update_log_t *log )
+{
+  deal_public( deal, rng );
+
+  /* Every opponent hand that fits with the board starts out reached */
+  for( int p = 0; p < ag.game->numPlayers; ++p ) {
+    walk_public( p, ag.betting_tree_root, 0, deal, &deal.valid[ 0 ],
+		 &deal.values[ 0 ], rng, stats, log );
+  }
+  stats.iterations += 1;
+}
+
+void PureCfrMachine::apply_update_log( const update_log_t &log,
+				       const int round )
+{
+  for( size_t i = 0; i < log.updates.size( ); ++i ) {
+    const logged_update_t &update = log.updates[ i ];
+    if( update.round != round ) {
+      continue;
+    }
+    if( update.num_choices > 0 ) {
+      regrets[ round ]->update_regret( update.bucket, update.soln_idx,
+				       update.num_choices,
+				       &log.values[ update.values_start ],
+				       update.retval );
+    } else {
+      increment_avg_strategy( round, update.bucket, update.soln_idx,
+			      update.choice );
+    }
+  }
+}
+
+void PureCfrMachine::increment_avg_strategy( const int8_t round,
+					     const int bucket,
+					     const int64_t soln_idx,
+					     const int choice )
+{
+  /* An entry at the largest value of its type stays there, and the lost
+   * increment is counted with the dropped updates
+   */
+  avg_strategy[ round ]->increment_entry( bucket, soln_idx, choice );
+}
+
+int PureCfrMachine::sample_choice( const int8_t round,
+				   const int bucket,
+				   const int64_t soln_idx,
+				   const int num_choices,
+				   rng_engine_t &rng ) const
+{
+  /* Get the positive regrets at this information set */
+  uint64_t pos_regrets[ num_choices ];
+  uint64_t sum_pos_regrets
+    = regrets[ round ]->get_pos_values( bucket,
+					soln_idx,
+					num_choices,
+					pos_regrets );
+  if( sum_pos_regrets == 0 ) {
+    /* No positive regret, so assume a default uniform random current strategy */
+    sum_pos_regrets = num_choices;
+    for( int c = 0; c < num_choices; ++c ) {
+      pos_regrets[ c ] = 1;
+    }
+  }
+
+  uint64_t dart = rng_bounded( rng, sum_pos_regrets );
+  int choice;
+  for( choice = 0; choice < num_choices; ++choice ) {
+    if( dart < pos_regrets[ choice ] ) {
+      break;
+    }
+    dart -= pos_regrets[ choice ];
+  }
+  assert( choice < num_choices );
+  assert( pos_regrets[ choice ] > 0 );
+
+  return choice;
+}
+
+void PureCfrMachine::add_avg_increment( const int8_t round,
+					const int bucket,
+					const int64_t soln_idx,
+					const int choice,
+					update_log_t *log )
+{
+  if( log != NULL ) {
+    logged_update_t update;
+    update.round = round;
+    update.num_choices = 0;
+    update.choice = choice;
+    update.bucket = bucket;
+    update.soln_idx = soln_idx;
+    log->updates.push_back( update );
+  } else {
+    increment_avg_strategy( round, bucket, soln_idx, choice );
+  }
+}
+
+void PureCfrMachine::add_regrets( const int8_t round,
+				  const int bucket,
+				  const int64_t soln_idx,
+				  const int num_choices,
+				  const int64_t *diffs,
+				  update_log_t *log )
+{
+  /* Regret updates are ints.  Scaled to a single deal, a bucket's sum is
+   * at most the number of private hands times the largest swing in
+   * winnings, far inside an int for any real game, so clamping only
+   * guards against absurd stacks.
+   */
+  int values[ num_choices ];
+  for( int c = 0; c < num_choices; ++c ) {
+    if( diffs[ c ] > INT_MAX ) {
+      values[ c ] = INT_MAX;
+    } else if( diffs[ c ] < -INT_MAX ) {
+      values[ c ] = -INT_MAX;
+    } else {
+      values[ c ] = diffs[ c ];
+    }
+  }
+
+  if( log != NULL ) {
+    logged_update_t update;
+    update.round = round;
+    update.num_choices = num_choices;
+    update.bucket = bucket;
+    update.soln_idx = soln_idx;
+    update.retval = 0;
+    update.values_start = log->values.size( );
+    log->updates.push_back( update );
+    log->values.insert( log->values.end( ), values, values + num_choices );
+  } else {
+    regrets[ round ]->update_regret( bucket, soln_idx, num_choices,
+				     values, 0 );
+  }
+}
+
+int PureCfrMachine::get_num_rounds( ) const
+{
+  return ag.game->numRounds;
+}
+
+int PureCfrMachine::get_num_deck_cards( ) const
+{
+  return ag.game->numRanks * ag.game->numSuits;
+}
+
+int PureCfrMachine::get_deck_card( const int index ) const
+{
+  return makeCard( index / ag.game->numSuits, index % ag.game->numSuits );
+}
+
+int PureCfrMachine::get_num_hole_classes( ) const
+{
+  int num_classes = 1;
+  for( int i = 0; i < num_class_cards; ++i ) {
+    num_classes *= get_num_deck_cards( ) - i;
+  }
+  return num_classes;
+}
+
+void PureCfrMachine::get_hole_class_cards( const int hole_class,
+					   uint8_t *cards ) const
+{
+  /* Peel off one digit per card, the first card's digit being the most
+   * significant, and count that many unused cards along the deck
+   */
+  bool used[ MAX_SUITS * MAX_RANKS ];
+  memset( used, 0, sizeof( used ) );
+  int place = get_num_hole_classes( );
+  for( int i = 0; i < num_class_cards; ++i ) {
+    place /= get_num_deck_cards( ) - i;
+    int digit = ( hole_class / place ) % ( get_num_deck_cards( ) - i );
+    int c = 0;
+    while( used[ c ] || ( digit > 0 ) ) {
+      digit -= !used[ c ];
+      ++c;
+    }
+    used[ c ] = true;
+    cards[ i ] = get_deck_card( c );
   }
 }
 
@@ -238,38 +558,253 @@ int PureCfrMachine::load_dump( const char *dump_prefix )
   return 0;
 }
 
-int PureCfrMachine::generate_hand( hand_t &hand, rng_state_t &rng )
+typedef struct {
+  const Entries *entries;
+  size_t begin;
+  size_t end;
+  saturation_t sat;
+} saturation_thread_args_t;
+
+static void *saturation_thread( void *thread_args )
+{
+  saturation_thread_args_t *args = ( saturation_thread_args_t * ) thread_args;
+
+  args->entries->get_saturation( args->begin, args->end, args->sat );
+
+  return NULL;
+}
+
+/* Computes the saturation of entries using num_threads threads */
+static void get_entries_saturation( const Entries *entries,
+				    const int num_threads,
+				    saturation_t &sat )
 {
-  /* First, deal out the cards and copy them over */
-  State state;
-  dealCards( ag.game, &rng, &state );
-  memcpy( hand.board_cards, state.boardCards,
-	  MAX_BOARD_CARDS * sizeof( hand.board_cards[ 0 ] ) );
-  for( int p = 0; p < MAX_PURE_CFR_PLAYERS; ++p ) {
-    memcpy( hand.hole_cards[ p ], state.holeCards[ p ],
-	    MAX_HOLE_CARDS * sizeof( hand.hole_cards[ 0 ] ) );
+  init_saturation( sat );
+
+  const size_t total = entries->get_total_num_entries( );
+  const size_t chunk = ( total + num_threads - 1 ) / num_threads;
+  saturation_thread_args_t args[ num_threads ];
+  pthread_t threads[ num_threads ];
+  bool launched[ num_threads ];
+  for( int t = 0; t < num_threads; ++t ) {
+    args[ t ].entries = entries;
+    args[ t ].begin = ( t * chunk < total ? t * chunk : total );
+    args[ t ].end = ( args[ t ].begin + chunk < total
+		      ? args[ t ].begin + chunk : total );
+    init_saturation( args[ t ].sat );
+    launched[ t ] = ( pthread_create( &threads[ t ], NULL, saturation_thread,
+				      &args[ t ] ) == 0 );
+    if( !launched[ t ] ) {
+      /* Couldn't get a thread, so do this chunk ourselves */
+      saturation_thread( &args[ t ] );
+    }
+  }
+  for( int t = 0; t < num_threads; ++t ) {
+    if( launched[ t ] ) {
+      pthread_join( threads[ t ], NULL );
+    }
+    add_saturation( sat, args[ t ].sat );
+  }
+}
+
+void PureCfrMachine::get_saturation( const int num_threads,
+				     saturation_t regret_sat[ MAX_ROUNDS ],
+				     saturation_t avg_sat[ MAX_ROUNDS ] ) const
+{
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    get_entries_saturation( regrets[ r ], num_threads, regret_sat[ r ] );
+    if( do_average ) {
+      get_entries_saturation( avg_strategy[ r ], num_threads, avg_sat[ r ] );
+    }
+  }
+}
+
+void PureCfrMachine::print_telemetry( FILE *file,
+				      const saturation_t *regret_sat,
+				      const saturation_t *avg_sat ) const
+{
+  fprintf( file, "REGRET_DROPPED_UPDATES" );
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    fprintf( file, " %ju", ( uintmax_t ) regrets[ r ]->get_num_dropped( ) );
   }
+  fprintf( file, "\n" );
+  if( do_average ) {
+    fprintf( file, "AVG_STRATEGY_DROPPED_UPDATES" );
+    for( int r = 0; r < ag.game->numRounds; ++r ) {
+      fprintf( file, " %ju",
+	       ( uintmax_t ) avg_strategy[ r ]->get_num_dropped( ) );
+    }
+    fprintf( file, "\n" );
+  }
+
+  /* One line per round: max absolute value, then the number of entries
+   * with 0, 1, 2, ... bits of headroom left
+   */
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    if( regret_sat != NULL ) {
+      fprintf( file, "REGRET_SATURATION %d %s %ju :", r,
+	       entry_type_to_str[ regrets[ r ]->get_entry_type( ) ],
+	       ( uintmax_t ) regret_sat[ r ].max_abs_value );
+      for( int b = 0; b < NUM_SATURATION_BINS; ++b ) {
+	fprintf( file, " %ju", ( uintmax_t ) regret_sat[ r ].histogram[ b ] );
+      }
+      fprintf( file, "\n" );
+    }
+    if( do_average && ( avg_sat != NULL ) ) {
+      fprintf( file, "AVG_STRATEGY_SATURATION %d %s %ju :", r,
+	       entry_type_to_str[ avg_strategy[ r ]->get_entry_type( ) ],
+	       ( uintmax_t ) avg_sat[ r ].max_abs_value );
+      for( int b = 0; b < NUM_SATURATION_BINS; ++b ) {
+	fprintf( file, " %ju", ( uintmax_t ) avg_sat[ r ].histogram[ b ] );
+      }
+      fprintf( file, "\n" );
+    }
+  }
+}
+
+/* Makes card player 0's hole card slot in a uniformly dealt hand.  If card
+ * was dealt elsewhere it swaps places with that hole card, otherwise it
+ * replaces it.  Every deal with card there is then reached from exactly as
+ * many uniform deals as there were cards that could be dealt there, so the
+ * result is distributed as a uniform deal conditioned on that hole card.
+ * Forcing hole cards 0, 1, ... in turn with distinct cards conditions on all
+ * of them, since a card forced earlier is never the one swapped.
+ */
+static void force_hole_card( const Game *game, hand_t &hand, const int slot,
+			     const uint8_t card )
+{
+  uint8_t *target = &hand.hole_cards[ 0 ][ slot ];
+  for( int p = 0; p < game->numPlayers; ++p ) {
+    for( int i = 0; i < game->numHoleCards; ++i ) {
+      if( hand.hole_cards[ p ][ i ] == card ) {
+	hand.hole_cards[ p ][ i ] = *target;
+	*target = card;
+	return;
+      }
+    }
+  }
+  int num_board_cards = sumBoardCards( game, game->numRounds - 1 );
+  for( int i = 0; i < num_board_cards; ++i ) {
+    if( hand.board_cards[ i ] == card ) {
+      hand.board_cards[ i ] = *target;
+      *target = card;
+      return;
+    }
+  }
+  *target = card;
+}
 
-  /* Bucket the hands for each player, round if possible */
+void PureCfrMachine::build_deal_table( const int64_t max_deals )
+{
+  /* Cards are dealt to the same places in the same order as dealCards */
+  const int num_cards = ag.game->numPlayers * ag.game->numHoleCards
+    + sumBoardCards( ag.game, ag.game->numRounds - 1 );
+  const int num_deck_cards = get_num_deck_cards( );
+  int64_t num_deals = 1;
+  for( int i = 0; i < num_cards; ++i ) {
+    num_deals *= num_deck_cards - i;
+    if( num_deals > max_deals ) {
+      fprintf( stderr, "Game has more than %jd deals, so dealing each hand "
+	       "as it is needed\n", ( intmax_t ) max_deals );
+      return;
+    }
+  }
+
+  deal_table = new hand_t[ num_deals ];
+  hand_t hand;
+  memset( &hand, 0, sizeof( hand ) );
+  uint8_t *slots[ MAX_PURE_CFR_PLAYERS * MAX_HOLE_CARDS + MAX_BOARD_CARDS ];
+  int num_slots = 0;
+  for( int p = 0; p < ag.game->numPlayers; ++p ) {
+    for( int i = 0; i < ag.game->numHoleCards; ++i ) {
+      slots[ num_slots++ ] = &hand.hole_cards[ p ][ i ];
+    }
+  }
+  while( num_slots < num_cards ) {
+    slots[ num_slots ] = &hand.board_cards[ num_slots - ag.game->numPlayers
+					    * ag.game->numHoleCards ];
+    ++num_slots;
+  }
+  bool used[ MAX_SUITS * MAX_RANKS ];
+  memset( used, 0, sizeof( used ) );
+  add_table_deals( hand, slots, num_cards, 0, used );
+  assert( num_table_deals == num_deals );
+
+  fprintf( stderr, "Dealt all %jd hands into a %.3lf MB table\n",
+	   ( intmax_t ) num_table_deals,
+	   num_table_deals * sizeof( hand_t ) / ( 1024.0 * 1024.0 ) );
+}
+
+void PureCfrMachine::add_table_deals( hand_t &hand, uint8_t **slots,
+				      const int num_slots, const int slot,
+				      bool *used )
+{
+  if( slot == num_slots ) {
+    deal_table[ num_table_deals ] = hand;
+    finish_hand( deal_table[ num_table_deals ] );
+    ++num_table_deals;
+    return;
+  }
+
+  /* Deck order, so that the deals in each hole class are together */
+  for( int c = 0; c < get_num_deck_cards( ); ++c ) {
+    if( !used[ c ] ) {
+      used[ c ] = true;
+      *slots[ slot ] = get_deck_card( c );
+      add_table_deals( hand, slots, num_slots, slot + 1, used );
+      used[ c ] = false;
+    }
+  }
+}
+
+int PureCfrMachine::generate_hand( hand_t &hand, rng_engine_t &rng,
+				   const int hole_class ) const
+{
+  if( deal_table != NULL ) {
+    /* Every deal is equally likely.  Deals are in deck order of player 0's
+     * hole cards, the same order hole classes are numbered in, so a class
+     * picks out a block of them.
+     */
+    if( hole_class >= 0 ) {
+      const int64_t block_size = num_table_deals / get_num_hole_classes( );
+      hand = deal_table[ hole_class * block_size
+			 + rng_bounded( rng, block_size ) ];
+    } else {
+      hand = deal_table[ rng_bounded( rng, num_table_deals ) ];
+    }
+    return 0;
+  }
+
+  /* Deal out the cards */
+  rng_deal_hand( ag.game, deck, rng, hand );
+  if( hole_class >= 0 ) {
+    uint8_t cards[ MAX_HOLE_CARDS ];
+    get_hole_class_cards( hole_class, cards );
+    for( int i = 0; i < num_class_cards; ++i ) {
+      force_hole_card( ag.game, hand, i, cards[ i ] );
+    }
+  }
+  return finish_hand( hand );
+}
+
+int PureCfrMachine::finish_hand( hand_t &hand ) const
+{
+  /* Unused players and rounds compare equal when hands are sorted */
+  memset( hand.precomputed_buckets, 0, sizeof( hand.precomputed_buckets ) );
+
+  /* Bucket the hands for each player, round if possible, and otherwise
+   * leave walk_pure_cfr to bucket them as they are reached
+   */
   if( ag.card_abs->can_precompute_buckets( ) ) {
     ag.card_abs->precompute_buckets( ag.game, hand );
+    hand.known_buckets = ~( uint32_t ) 0;
+  } else {
+    hand.known_buckets = 0;
   }
 
   /* Rank the hands */
   int ranks[ MAX_PURE_CFR_PLAYERS ];
-  int top_rank = -1;
-  int num_ties = 1;;
-  /* State must be in the final round for rankHand to work properly */
-  state.round = ag.game->numRounds - 1;
-  for( int p = 0; p < ag.game->numPlayers; ++p ) {
-    ranks[ p ] = rankHand( ag.game, &state, p );
-    if( ranks[ p ] > top_rank ) {
-      top_rank = ranks[ p ];
-      num_ties = 1;
-    } else if( ranks[ p ] == top_rank ) {
-      ++num_ties;
-    }
-  }
+  evaluator.rank_hands( hand, ranks );
 
   /* Set evaluation values */
   switch( ag.game->numPlayers ) {
@@ -289,74 +824,26 @@ int PureCfrMachine::generate_hand( hand_t &hand, rng_state_t &rng )
     }
     break;
 
-  case 3:
-    /* Two players fold */
-    hand.eval.pot_frac_recip[ 0 ][ LEAF_P0 ] = 1;
-    hand.eval.pot_frac_recip[ 1 ][ LEAF_P0 ] = INT_MAX;
-    hand.eval.pot_frac_recip[ 2 ][ LEAF_P0 ] = INT_MAX;
-    hand.eval.pot_frac_recip[ 0 ][ LEAF_P1 ] = INT_MAX;
-    hand.eval.pot_frac_recip[ 1 ][ LEAF_P1 ] = 1;    
-    hand.eval.pot_frac_recip[ 2 ][ LEAF_P1 ] = INT_MAX;
-    hand.eval.pot_frac_recip[ 0 ][ LEAF_P2 ] = INT_MAX;
-    hand.eval.pot_frac_recip[ 1 ][ LEAF_P2 ] = INT_MAX;    
-    hand.eval.pot_frac_recip[ 2 ][ LEAF_P2 ] = 1;
-    /* One player folds */
-    hand.eval.pot_frac_recip[ 0 ][ LEAF_P1_P2 ] = INT_MAX;  
-    hand.eval.pot_frac_recip[ 1 ][ LEAF_P0_P2 ] = INT_MAX;  
-    hand.eval.pot_frac_recip[ 2 ][ LEAF_P0_P1 ] = INT_MAX;  
-    if( ranks[ 0 ] > ranks[ 1 ] ) {
-      /* Player 0 wins in showdown when player 2 folds */
-      hand.eval.pot_frac_recip[ 0 ][ LEAF_P0_P1 ] = 1;
-      hand.eval.pot_frac_recip[ 1 ][ LEAF_P0_P1 ] = INT_MAX;
-    } else if( ranks[ 0 ] < ranks[ 1 ] ) {
-      /* Player 1 wins in showdown when player 2 folds */
-      hand.eval.pot_frac_recip[ 0 ][ LEAF_P0_P1 ] = INT_MAX;
-      hand.eval.pot_frac_recip[ 1 ][ LEAF_P0_P1 ] = 1;
-    } else {
-      /* Players 0 and 1 tie in showdown when player 2 folds */
-      hand.eval.pot_frac_recip[ 0 ][ LEAF_P0_P1 ] = 2;
-      hand.eval.pot_frac_recip[ 1 ][ LEAF_P0_P1 ] = 2; 
-    }    
-    if( ranks[ 0 ] > ranks[ 2 ] ) {
-      /* Player 0 wins in showdown when player 1 folds */
-      hand.eval.pot_frac_recip[ 0 ][ LEAF_P0_P2 ] = 1;
-      hand.eval.pot_frac_recip[ 2 ][ LEAF_P0_P2 ] = INT_MAX;
-    } else if( ranks[ 0 ] < ranks[ 2 ] ) {
-      /* Player 2 wins in showdown when player 1 folds */
-      hand.eval.pot_frac_recip[ 0 ][ LEAF_P0_P2 ] = INT_MAX;
-      hand.eval.pot_frac_recip[ 2 ][ LEAF_P0_P2 ] = 1;
-    } else {
-      /* Players 0 and 2 tie in showdown when player 1 folds */
-      hand.eval.pot_frac_recip[ 0 ][ LEAF_P0_P2 ] = 2;
-      hand.eval.pot_frac_recip[ 2 ][ LEAF_P0_P2 ] = 2; 
-    }    
-    if( ranks[ 1 ] > ranks[ 2 ] ) {
-      /* Player 1 wins in showdown when player 0 folds */
-      hand.eval.pot_frac_recip[ 1 ][ LEAF_P1_P2 ] = 1;
-      hand.eval.pot_frac_recip[ 2 ][ LEAF_P1_P2 ] = INT_MAX;
-    } else if( ranks[ 1 ] < ranks[ 2 ] ) {
-      /* Player 2 wins in showdown when player 0 folds */
-      hand.eval.pot_frac_recip[ 1 ][ LEAF_P1_P2 ] = INT_MAX;
-      hand.eval.pot_frac_recip[ 2 ][ LEAF_P1_P2 ] = 1;
-    } else {
-      /* Players 1 and 2 tie in showdown when player 0 folds */
-      hand.eval.pot_frac_recip[ 1 ][ LEAF_P1_P2 ] = 2;
-      hand.eval.pot_frac_recip[ 2 ][ LEAF_P1_P2 ] = 2; 
+  default: {
+    /* Sort the players from best hand to worst.  Players past the end of the
+     * game never fold and get a strength below every real player, which
+     * stops TerminalNodeNp's walk down the order.
+     */
+    int8_t *order = hand.eval.showdown_np.order;
+    int8_t *strength = hand.eval.showdown_np.strength;
+    for( int p = 0; p < MAX_PURE_CFR_PLAYERS; ++p ) {
+      order[ p ] = p;
+      strength[ p ] = INT8_MAX;
     }
-    /* No players fold */
-    for( int p = 0; p < ag.game->numPlayers; ++p ) {
-      if( ranks[ p ] == top_rank ) {
-	hand.eval.pot_frac_recip[ p ][ LEAF_P0_P1_P2 ] = num_ties;
-      } else {
-	hand.eval.pot_frac_recip[ p ][ LEAF_P0_P1_P2 ] = INT_MAX;
-      }
+    std::sort( order, order + ag.game->numPlayers,
+	       [ &ranks ]( int8_t a, int8_t b ) { return ranks[ a ] > ranks[ b ]; } );
+    strength[ order[ 0 ] ] = 0;
+    for( int i = 1; i < ag.game->numPlayers; ++i ) {
+      strength[ order[ i ] ] = strength[ order[ i - 1 ] ]
+	+ ( ranks[ order[ i ] ] != ranks[ order[ i - 1 ] ] );
     }
     break;
-
-  default:
-    fprintf( stderr, "can't set terminal pot fraction denominators in "
-	     "%d-player game\n", ag.game->numPlayers );
-    return 1;
+  }
   }
 
   return 0;  
@@ -364,8 +851,10 @@ int PureCfrMachine::generate_hand( hand_t &hand, rng_state_t &rng )
 
 int PureCfrMachine::walk_pure_cfr( const int position,
 				   const BettingNode *cur_node,
-				   const hand_t &hand,
-				   rng_state_t &rng )
+				   hand_t &hand,
+				   rng_engine_t &rng,
+				   thread_stats_t &stats,
+				   update_log_t *log )
 {
   int retval = 0;
 
@@ -374,7 +863,8 @@ int PureCfrMachine::walk_pure_cfr( const int position,
     /* Game over, calculate utility */
     
     retval = cur_node->evaluate( hand, position );
-    
+    stats.terminal_evaluations += 1;
+
     return retval;
   }
 
@@ -383,40 +873,23 @@ int PureCfrMachine::walk_pure_cfr( const int position,
   int8_t player = cur_node->get_player( );
   int8_t round = cur_node->get_round( );
   int64_t soln_idx = cur_node->get_soln_idx( );
-  int bucket;
-  if( ag.card_abs->can_precompute_buckets( ) ) {
-    bucket = hand.precomputed_buckets[ player ][ round ];
-  } else {
-    bucket = ag.card_abs->get_bucket( ag.game, cur_node, hand.board_cards,
-				      hand.hole_cards );
-  }
-
-  /* Get the positive regrets at this information set */
-  uint64_t pos_regrets[ num_choices ];
-  uint64_t sum_pos_regrets
-    = regrets[ round ]->get_pos_values( bucket,
-					soln_idx,
-					num_choices,
-					pos_regrets );
-  if( sum_pos_regrets == 0 ) {
-    /* No positive regret, so assume a default uniform random current strategy */
-    sum_pos_regrets = num_choices;
-    for( int c = 0; c < num_choices; ++c ) {
-      pos_regrets[ c ] = 1;
+  stats.nodes_visited[ round ] += 1;
+  /* Bucket each player's cards once per round, on the first visit of
+   * any walk of this hand
+   */
+  const uint32_t bucket_bit = ( uint32_t ) 1 << ( player * MAX_ROUNDS + round );
+  if( !( hand.known_buckets & bucket_bit ) ) {
+    hand.precomputed_buckets[ player ][ round ]
+      = ag.card_abs->get_bucket( ag.game, cur_node, hand.board_cards,
+				 hand.hole_cards );
+    if( ag.card_abs->can_cache_buckets( ) ) {
+      hand.known_buckets |= bucket_bit;
     }
   }
+  int bucket = hand.precomputed_buckets[ player ][ round ];
 
   /* Purify the current strategy so that we always take choice */
-  uint64_t dart = genrand_int32( &rng ) % sum_pos_regrets;
-  int choice;
-  for( choice = 0; choice < num_choices; ++choice ) {
-    if( dart < pos_regrets[ choice ] ) {
-      break;
-    }
-    dart -= pos_regrets[ choice ];
-  }
-  assert( choice < num_choices );
-  assert( pos_regrets[ choice ] > 0 );
+  int choice = sample_choice( round, bucket, soln_idx, num_choices, rng );
   
   const BettingNode *child = cur_node->get_child( );
 
@@ -427,16 +900,12 @@ int PureCfrMachine::walk_pure_cfr( const int position,
       child = child->get_sibling( );
     }
 
-    retval = walk_pure_cfr( position, child, hand, rng );
+    retval = walk_pure_cfr( position, child, hand, rng, stats, log );
 
     /* Update the average strategy if we are keeping track of one */
     if( do_average ) {
-      if( avg_strategy[ round ]->increment_entry( bucket, soln_idx, choice ) ) {
-	fprintf( stderr, "The average strategy has overflown :(\n" );
-	fprintf( stderr, "To fix this, you must set a bigger AVG_STRATEGY_TYPE "
-		 "in constants.cpp and start again from scratch.\n" );
-	exit( 1 );
-      }
+      add_avg_increment( round, bucket, soln_idx, choice, log );
+      stats.avg_strategy_increments += 1;
     }
     
   } else {
@@ -445,7 +914,7 @@ int PureCfrMachine::walk_pure_cfr( const int position,
     int values[ num_choices ];
     
     for( int c = 0; c < num_choices; ++c ) {
-      values[ c ] = walk_pure_cfr( position, child, hand, rng );
+      values[ c ] = walk_pure_cfr( position, child, hand, rng, stats, log );
       child = child->get_sibling( );
     }
 
@@ -453,9 +922,332 @@ int PureCfrMachine::walk_pure_cfr( const int position,
     retval = values[ choice ];
 
     /* Update the regrets at the current node */
-    regrets[ round ]->update_regret( bucket, soln_idx, num_choices,
-				     values, retval );
+    if( log != NULL ) {
+      logged_update_t update;
+      update.round = round;
+      update.num_choices = num_choices;
+      update.bucket = bucket;
+      update.soln_idx = soln_idx;
+      update.retval = retval;
+      update.values_start = log->values.size( );
+      log->updates.push_back( update );
+      log->values.insert( log->values.end( ), values, values + num_choices );
+    } else {
+      regrets[ round ]->update_regret( bucket, soln_idx, num_choices,
+				       values, retval );
+    }
+    stats.regret_updates += 1;
   }
   
   return retval;
 }
+
+void PureCfrMachine::deal_public( public_deal_t &deal,
+				  rng_engine_t &rng ) const
+{
+  /* Deal as usual and keep just the board */
+  hand_t hand;
+  memset( &hand, 0, sizeof( hand ) );
+  rng_deal_hand( ag.game, deck, rng, hand );
+  bool on_board[ MAX_SUITS * MAX_RANKS ];
+  memset( on_board, 0, sizeof( on_board ) );
+  for( int i = 0; i < sumBoardCards( ag.game, ag.game->numRounds - 1 ); ++i ) {
+    on_board[ hand.board_cards[ i ] ] = true;
+  }
+
+  /* Every valid hand leaves the same number of cards for the opponent */
+  const int num_left = ( get_num_deck_cards( )
+			 - sumBoardCards( ag.game, ag.game->numRounds - 1 )
+			 - ag.game->numHoleCards );
+  deal.num_opp_hands = ( ag.game->numHoleCards == 2
+			 ? num_left * ( num_left - 1 ) : num_left );
+
+  /* Sized by init_public_deal, so only the contents change here */
+  std::fill( deal.valid.begin( ), deal.valid.end( ), 0 );
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    std::fill( deal.buckets[ r ].begin( ), deal.buckets[ r ].end( ), 0 );
+    deal.bucket_order[ r ].clear( );
+  }
+  std::fill( deal.ranks.begin( ), deal.ranks.end( ), 0 );
+  deal.rank_order.clear( );
+
+  for( int i = 0; i < num_private_hands; ++i ) {
+    const uint8_t *cards = &private_hands[ i * MAX_HOLE_CARDS ];
+    bool valid = true;
+    for( int c = 0; c < ag.game->numHoleCards; ++c ) {
+      if( on_board[ cards[ c ] ] ) {
+	valid = false;
+      }
+    }
+    if( !valid ) {
+      continue;
+    }
+    deal.valid[ i ] = 1;
+
+    /* Both players hold the hand, so either's buckets and rank will do */
+    for( int p = 0; p < ag.game->numPlayers; ++p ) {
+      for( int c = 0; c < ag.game->numHoleCards; ++c ) {
+	hand.hole_cards[ p ][ c ] = cards[ c ];
+      }
+    }
+    ag.card_abs->precompute_buckets( ag.game, hand );
+    for( int r = 0; r < ag.game->numRounds; ++r ) {
+      deal.buckets[ r ][ i ] = hand.precomputed_buckets[ 0 ][ r ];
+      deal.bucket_order[ r ].push_back( i );
+    }
+    int ranks[ MAX_PURE_CFR_PLAYERS ];
+    evaluator.rank_hands( hand, ranks );
+    deal.ranks[ i ] = ranks[ 0 ];
+    deal.rank_order.push_back( i );
+  }
+
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    const std::vector<int> &buckets = deal.buckets[ r ];
+    std::sort( deal.bucket_order[ r ].begin( ), deal.bucket_order[ r ].end( ),
+	       [ &buckets ]( int a, int b ) { return buckets[ a ] < buckets[ b ]; } );
+  }
+  const std::vector<int> &ranks = deal.ranks;
+  std::sort( deal.rank_order.begin( ), deal.rank_order.end( ),
+	     [ &ranks ]( int a, int b ) { return ranks[ a ] < ranks[ b ]; } );
+}
+
+void PureCfrMachine::walk_public( const int position,
+				  const BettingNode *cur_node,
+				  const int depth,
+				  public_deal_t &deal,
+				  const uint8_t *opp_reach,
+				  int *values,
+				  rng_engine_t &rng,
+				  thread_stats_t &stats,
+				  update_log_t *log )
+{
+  const int num_hands = num_private_hands;
+
+  if( cur_node->get_child( ) == NULL ) {
+    /* Game over, calculate utility */
+    evaluate_public( position, cur_node, deal, opp_reach, values );
+    stats.terminal_evaluations += 1;
+    return;
+  }
+
+  /* Grab some values that will be used often */
+  int num_choices = cur_node->get_num_choices( );
+  int8_t player = cur_node->get_player( );
+  int8_t round = cur_node->get_round( );
+  int64_t soln_idx = cur_node->get_soln_idx( );
+  stats.nodes_visited[ round ] += 1;
+  const int *buckets = &deal.buckets[ round ][ 0 ];
+
+  /* This node's share of the scratch space */
+  uint8_t *choices = &deal.choices[ ( size_t ) depth * num_hands ];
+  uint8_t *child_reach = &deal.reach[ ( size_t ) depth * num_hands ];
+  int *child_values
+    = &deal.values[ ( size_t ) ( depth + 1 ) * max_public_choices * num_hands ];
+
+  /* Purify the current strategy of every hand the acting player can hold */
+  const uint8_t *acting = ( player == position ? &deal.valid[ 0 ] : opp_reach );
+  for( int i = 0; i < num_hands; ++i ) {
+    if( acting[ i ] ) {
+      choices[ i ] = sample_choice( round, buckets[ i ], soln_idx, num_choices,
+				    rng );
+    }
+  }
+
+  const BettingNode *child = cur_node->get_child( );
+
+  if( player != position ) {
+    /* Opponent's node.  Each opponent hand follows its own choice, so the
+     * children share out the opponent's hands between them.
+     */
+    memset( values, 0, num_hands * sizeof( values[ 0 ] ) );
+    for( int c = 0; c < num_choices; ++c ) {
+      bool reached = false;
+      for( int i = 0; i < num_hands; ++i ) {
+	child_reach[ i ] = ( opp_reach[ i ] && ( choices[ i ] == c ) );
+	reached = reached || child_reach[ i ];
+      }
+      if( reached ) {
+	walk_public( position, child, depth + 1, deal, child_reach,
+		     child_values, rng, stats, log );
+	for( int i = 0; i < num_hands; ++i ) {
+	  values[ i ] += child_values[ i ];
+	}
+      }
+      child = child->get_sibling( );
+    }
+
+    /* Update the average strategy if we are keeping track of one */
+    if( do_average ) {
+      for( int i = 0; i < num_hands; ++i ) {
+	if( opp_reach[ i ] ) {
+	  add_avg_increment( round, buckets[ i ], soln_idx, choices[ i ], log );
+	  stats.avg_strategy_increments += 1;
+	}
+      }
+    }
+
+  } else {
+    /* Current player's node. Recurse down all choices to get the value of
+     * each for every hand
+     */
+    for( int c = 0; c < num_choices; ++c ) {
+      walk_public( position, child, depth + 1, deal, opp_reach,
+		   &child_values[ c * num_hands ], rng, stats, log );
+      child = child->get_sibling( );
+    }
+
+    /* Each hand returns the value its sampled pure strategy attains */
+    for( int i = 0; i < num_hands; ++i ) {
+      values[ i ] = ( deal.valid[ i ]
+		      ? child_values[ choices[ i ] * num_hands + i ] : 0 );
+    }
+
+    /* Update the regrets, summing over the hands in each bucket.  Values
+     * are summed over every opponent hand, so each hand's share is divided
+     * by the number of opponent hands to weigh it as a single deal would,
+     * rounding up or down at random to keep the expected update exact.
+     */
+    const int64_t num_opp_hands = deal.num_opp_hands;
+    const std::vector<int> &order = deal.bucket_order[ round ];
+    size_t k = 0;
+    while( k < order.size( ) ) {
+      const int bucket = buckets[ order[ k ] ];
+      int64_t diffs[ num_choices ];
+      memset( diffs, 0, num_choices * sizeof( diffs[ 0 ] ) );
+      for( ; ( k < order.size( ) ) && ( buckets[ order[ k ] ] == bucket ); ++k ) {
+	const int i = order[ k ];
+	for( int c = 0; c < num_choices; ++c ) {
+	  diffs[ c ] += child_values[ c * num_hands + i ] - values[ i ];
+	}
+      }
+      for( int c = 0; c < num_choices; ++c ) {
+	int64_t quotient = diffs[ c ] / num_opp_hands;
+	int64_t remainder = diffs[ c ] % num_opp_hands;
+	if( remainder < 0 ) {
+	  quotient -= 1;
+	  remainder += num_opp_hands;
+	}
+	if( ( int64_t ) rng_bounded( rng, num_opp_hands ) < remainder ) {
+	  quotient += 1;
+	}
+	diffs[ c ] = quotient;
+      }
+      add_regrets( round, bucket, soln_idx, num_choices, diffs, log );
+      stats.regret_updates += 1;
+    }
+  }
+}
+
+/* Adds amount of the hand with the given cards to counts */
+static void add_card_counts( card_counts_t &counts,
+			     const uint8_t *cards,
+			     const int num_hole_cards,
+			     const int amount )
+{
+  counts.total += amount;
+  for( int c = 0; c < num_hole_cards; ++c ) {
+    counts.card[ cards[ c ] ] += amount;
+  }
+  if( num_hole_cards == 2 ) {
+    const int low = ( cards[ 0 ] < cards[ 1 ] ? cards[ 0 ] : cards[ 1 ] );
+    const int high = ( cards[ 0 ] < cards[ 1 ] ? cards[ 1 ] : cards[ 0 ] );
+    counts.pair[ low ][ high ] += amount;
+  }
+}
+
+/* Number of counted hands sharing no card with the given cards */
+static int count_compatible( const card_counts_t &counts,
+			     const uint8_t *cards,
+			     const int num_hole_cards )
+{
+  int count = counts.total;
+  for( int c = 0; c < num_hole_cards; ++c ) {
+    count -= counts.card[ cards[ c ] ];
+  }
+  if( num_hole_cards == 2 ) {
+    /* Hands holding both cards were taken away twice */
+    const int low = ( cards[ 0 ] < cards[ 1 ] ? cards[ 0 ] : cards[ 1 ] );
+    const int high = ( cards[ 0 ] < cards[ 1 ] ? cards[ 1 ] : cards[ 0 ] );
+    count += counts.pair[ low ][ high ];
+  }
+  return count;
+}
+
+void PureCfrMachine::evaluate_public( const int position,
+				      const BettingNode *node,
+				      public_deal_t &deal,
+				      const uint8_t *opp_reach,
+				      int *values ) const
+{
+  const int num_hole_cards = ag.game->numHoleCards;
+  const int showdown_money = node->get_showdown_money( );
+  card_counts_t &counts = deal.counts[ 0 ];
+  const std::vector<int> &order = deal.rank_order;
+
+  memset( values, 0, num_private_hands * sizeof( values[ 0 ] ) );
+  for( size_t k = 0; k < order.size( ); ++k ) {
+    if( opp_reach[ order[ k ] ] ) {
+      add_card_counts( counts, &private_hands[ order[ k ] * MAX_HOLE_CARDS ],
+		       num_hole_cards, 1 );
+    }
+  }
+
+  if( showdown_money == 0 ) {
+    /* Someone folded, so every opponent hand is worth the same */
+    const int money = node->get_fold_money( position );
+    for( size_t k = 0; k < order.size( ); ++k ) {
+      const int i = order[ k ];
+      values[ i ] = money
+	* count_compatible( counts, &private_hands[ i * MAX_HOLE_CARDS ],
+			    num_hole_cards );
+    }
+    for( size_t k = 0; k < order.size( ); ++k ) {
+      if( opp_reach[ order[ k ] ] ) {
+	add_card_counts( counts, &private_hands[ order[ k ] * MAX_HOLE_CARDS ],
+			 num_hole_cards, -1 );
+      }
+    }
+    return;
+  }
+
+  /* Showdown.  Going up through the hands by rank, one group of tied hands
+   * at a time, take the group's opponent hands out of the counts, which
+   * then hold just the stronger opponent hands.  Running the counts back up
+   * at the same time gives the weaker ones.
+   */
+  card_counts_t &weaker = deal.counts[ 1 ];
+  size_t start = 0;
+  while( start < order.size( ) ) {
+    size_t end = start;
+    while( ( end < order.size( ) )
+	   && ( deal.ranks[ order[ end ] ] == deal.ranks[ order[ start ] ] ) ) {
+      ++end;
+    }
+    for( size_t k = start; k < end; ++k ) {
+      if( opp_reach[ order[ k ] ] ) {
+	add_card_counts( counts, &private_hands[ order[ k ] * MAX_HOLE_CARDS ],
+			 num_hole_cards, -1 );
+      }
+    }
+    for( size_t k = start; k < end; ++k ) {
+      const int i = order[ k ];
+      const uint8_t *cards = &private_hands[ i * MAX_HOLE_CARDS ];
+      values[ i ] = showdown_money
+	* ( count_compatible( weaker, cards, num_hole_cards )
+	    - count_compatible( counts, cards, num_hole_cards ) );
+    }
+    for( size_t k = start; k < end; ++k ) {
+      if( opp_reach[ order[ k ] ] ) {
+	add_card_counts( weaker, &private_hands[ order[ k ] * MAX_HOLE_CARDS ],
+			 num_hole_cards, 1 );
+      }
+    }
+    start = end;
+  }
+  for( size_t k = 0; k < order.size( ); ++k ) {
+    if( opp_reach[ order[ k ] ] ) {
+      add_card_counts( weaker, &private_hands[ order[ k ] * MAX_HOLE_CARDS ],
+		       num_hole_cards, -1 );
+    }
+  }
+}
@@ -12,6 +12,7 @@
  */
 
 /* C / C++ / STL indluces */
+#include <vector>
 
 /* project_acpc_server includes */
 extern "C" {
@@ -24,6 +25,77 @@ extern "C" {
 #include "constants.hpp"
 #include "hand.hpp"
 #include "abstract_game.hpp"
+#include "rng_engine.hpp"
+#include "hand_evaluator.hpp"
+
+/* Work counters for one worker thread.  Only the owning thread writes them,
+ * and each block sits on its own cache line so that neighbouring threads'
+ * counters do not share a line.  Other threads may read them at any time
+ * for status reports.
+ */
+typedef struct alignas( CACHE_LINE_SIZE ) {
+  int64_t iterations;
+  int64_t nodes_visited[ MAX_ROUNDS ]; /* choice nodes walked, by round */
+  int64_t terminal_evaluations;
+  int64_t regret_updates; /* regret rows updated */
+  int64_t avg_strategy_increments;
+  int64_t paused_usecs;
+  int64_t hands_dealt; /* dealt by the worker because its ring was empty */
+} thread_stats_t;
+
+void init_thread_stats( thread_stats_t &stats );
+
+/* A regret or avg strategy update held back until the end of an epoch */
+typedef struct {
+  int8_t round;
+  int8_t num_choices; /* 0 for an avg strategy increment */
+  int8_t choice; /* avg strategy increments only */
+  int bucket;
+  int64_t soln_idx;
+  int retval; /* regret updates only */
+  size_t values_start; /* regret updates only, index into values */
+} logged_update_t;
+
+/* The updates made by one thread during a deterministic epoch, in the order
+ * they were made
+ */
+typedef struct {
+  std::vector<logged_update_t> updates;
+  std::vector<int> values;
+} update_log_t;
+
+/* Counts of opponent hands by the cards they hold, so that the hands sharing
+ * no card with a given hand can be counted in constant time
+ */
+typedef struct {
+  int total;
+  int card[ MAX_SUITS * MAX_RANKS ];
+  int pair[ MAX_SUITS * MAX_RANKS ][ MAX_SUITS * MAX_RANKS ]; /* low, high */
+} card_counts_t;
+
+/* A sampled board and what it means for each private hand.  Each worker
+ * keeps one, set up by init_public_deal, and reuses it for every iteration.
+ */
+typedef struct {
+  std::vector<uint8_t> valid; /* hand shares no card with the board */
+  /* Opponent hands that share no card with the board or with any one
+   * valid hand, the same for every valid hand
+   */
+  int num_opp_hands;
+  std::vector<int> buckets[ MAX_ROUNDS ];
+  std::vector<int> bucket_order[ MAX_ROUNDS ]; /* valid hands by bucket */
+  std::vector<int> ranks;
+  std::vector<int> rank_order; /* valid hands by increasing rank */
+  card_counts_t counts[ 2 ]; /* scratch for terminal values, left zeroed */
+  /* Scratch for walk_public, so that nothing is allocated during a walk.
+   * The node at depth d of a walk uses level d of choices and reach, and
+   * writes its children's values to level d + 1 of values.  A level of
+   * values has room for every choice of every hand.
+   */
+  std::vector<uint8_t> choices;
+  std::vector<uint8_t> reach;
+  std::vector<int> values;
+} public_deal_t;
 
 class PureCfrMachine {
 public:
@@ -31,23 +103,161 @@ public:
   PureCfrMachine( const Parameters &params );
   ~PureCfrMachine( );
 
-  void do_iteration( rng_state_t &rng );
+  /* If hole_class is not negative, player 0's leading hole cards are those
+   * of that class (see get_hole_class_cards) and the rest of the deal is
+   * sampled from its conditional distribution.
+   * If log is not NULL, regret and avg strategy updates are recorded there
+   * instead of being applied.
+   */
+  void do_iteration( rng_engine_t &rng, thread_stats_t &stats,
+		     const int hole_class = -1,
+		     update_log_t *log = NULL );
+
+  /* Samples num_hands hands into hands, sorts them by their precomputed
+   * buckets so that hands sharing regret rows are walked one after another,
+   * then runs an iteration on each.  hands and order are the caller's
+   * scratch space for num_hands entries each, so that a batch is not kept
+   * on the stack.  hole_class and log are as for do_iteration.
+   */
+  void do_iteration_batch( rng_engine_t &rng, thread_stats_t &stats,
+			   hand_t *hands, hand_t **order,
+			   const int num_hands, const int hole_class = -1,
+			   update_log_t *log = NULL );
+
+  /* Runs an iteration on each of the given hands, sorted as for
+   * do_iteration_batch.  order is scratch space for num_hands pointers.
+   */
+  void do_iteration_hands( hand_t *hands, hand_t **order,
+			   const int num_hands,
+			   rng_engine_t &rng, thread_stats_t &stats,
+			   update_log_t *log = NULL );
+
+  /* Deals a hand, ranks it and precomputes its buckets if possible.  Only
+   * reads shared state, so any thread may call it.  hole_class is as for
+   * do_iteration.  Returns 0 on success, 1 on failure.
+   */
+  int generate_hand( hand_t &hand, rng_engine_t &rng,
+		     const int hole_class = -1 ) const;
+
+  /* Sizes the scratch space of deal for do_public_iteration */
+  void init_public_deal( public_deal_t &deal ) const;
+
+  /* Samples only the board into deal, then walks the tree once per player
+   * for every private hand at once.  Each private hand of each player
+   * samples its own pure strategy, and an opponent's hands are split
+   * between the actions they take, so a walk does the work of a Pure CFR
+   * iteration for every pair of private hands.  2p only.  log is as for
+   * do_iteration.
+   */
+  void do_public_iteration( public_deal_t &deal, rng_engine_t &rng,
+			    thread_stats_t &stats, update_log_t *log = NULL );
+
+  /* Applies the updates to round's tables in the log, in order */
+  void apply_update_log( const update_log_t &log, const int round );
+
+  int get_num_rounds( ) const;
+  /* Cards in the deck, indexed in order of rank and then suit */
+  int get_num_deck_cards( ) const;
+  int get_deck_card( const int index ) const;
+  /* Player 0's leading hole cards, numbered in deck order of the first card,
+   * then of the second among the cards left, and so on.  Every class is
+   * dealt equally often.  With --chance-sampling=STRATIFIED a class is all
+   * of player 0's hole cards, and otherwise just the first.
+   */
+  int get_num_hole_classes( ) const;
+  void get_hole_class_cards( const int hole_class, uint8_t *cards ) const;
   
   /* Returns 0 on success, 1 on failure, -1 on warning */
   int write_dump( const char *dump_prefix, const bool do_regrets = true ) const;
   int load_dump( const char *dump_prefix ); 
 
+  /* Histograms how close every regret and avg strategy entry is to the limits
+   * of its type, splitting the pass over num_threads threads.
+   * avg_sat is untouched if no average strategy is kept.
+   */
+  void get_saturation( const int num_threads,
+		       saturation_t regret_sat[ MAX_ROUNDS ],
+		       saturation_t avg_sat[ MAX_ROUNDS ] ) const;
+  /* Prints dropped update counts and, if not NULL, saturation histograms */
+  void print_telemetry( FILE *file,
+			const saturation_t *regret_sat = NULL,
+			const saturation_t *avg_sat = NULL ) const;
+
 protected:  
-  int generate_hand( hand_t &hand, rng_state_t &rng );
   int walk_pure_cfr( const int position,
 		     const BettingNode *cur_node,
-		     const hand_t &hand,
-		     rng_state_t &rng );
+		     hand_t &hand,
+		     rng_engine_t &rng,
+		     thread_stats_t &stats,
+		     update_log_t *log );
+  void increment_avg_strategy( const int8_t round,
+			       const int bucket,
+			       const int64_t soln_idx,
+			       const int choice );
+  /* Samples a choice from the current strategy at the information set */
+  int sample_choice( const int8_t round, const int bucket,
+		     const int64_t soln_idx, const int num_choices,
+		     rng_engine_t &rng ) const;
+  /* Applies or logs an avg strategy increment */
+  void add_avg_increment( const int8_t round, const int bucket,
+			  const int64_t soln_idx, const int choice,
+			  update_log_t *log );
+  /* Applies or logs adding diffs[ c ] to the regret of each choice c */
+  void add_regrets( const int8_t round, const int bucket,
+		    const int64_t soln_idx, const int num_choices,
+		    const int64_t *diffs, update_log_t *log );
+  void deal_public( public_deal_t &deal, rng_engine_t &rng ) const;
+  /* Sets values[ i ] to the value to position of holding private hand i,
+   * summed over the opponent hands j with opp_reach[ j ] set that share no
+   * card with i.  depth is the number of choice nodes above cur_node.
+   */
+  void walk_public( const int position,
+		    const BettingNode *cur_node,
+		    const int depth,
+		    public_deal_t &deal,
+		    const uint8_t *opp_reach,
+		    int *values,
+		    rng_engine_t &rng,
+		    thread_stats_t &stats,
+		    update_log_t *log );
+  void evaluate_public( const int position,
+			const BettingNode *node,
+			public_deal_t &deal,
+			const uint8_t *opp_reach,
+			int *values ) const;
+  /* Buckets and ranks the cards already dealt into hand.
+   * Returns 0 on success, 1 on failure.
+   */
+  int finish_hand( hand_t &hand ) const;
+  /* Fills deal_table with every possible deal, unless there are more than
+   * max_deals of them
+   */
+  void build_deal_table( const int64_t max_deals );
+  void add_table_deals( hand_t &hand, uint8_t **slots, const int num_slots,
+			const int slot, bool *used );
 
   AbstractGame ag;
+  const HandEvaluator evaluator;
+  /* Dealt from by every thread without going through an ACPC State */
+  deck_t deck;
   const bool do_average;
   Entries *regrets[ MAX_ROUNDS ];
   Entries *avg_strategy[ MAX_ROUNDS ];
+  /* Every deal, equally likely, or NULL to deal each hand as needed */
+  hand_t *deal_table;
+  int64_t num_table_deals;
+  /* Every private hand, in the order it is dealt, for public chance
+   * sampling.  Hand i's cards start at private_hands[ i * MAX_HOLE_CARDS ].
+   */
+  uint8_t *private_hands;
+  int num_private_hands;
+  /* Most choice nodes on any path through the tree, and most choices at
+   * any node, which size the scratch space of walk_public
+   */
+  int max_public_depth;
+  int max_public_choices;
+  /* Number of player 0's hole cards that make up a hole class */
+  int num_class_cards;
 };
 
 #endif
@@ -0,0 +1,85 @@
+/* rng_engine.cpp
+ * Random number generators used by the worker threads.  The Mersenne
+ * Twister from the ACPC server code reproduces runs made before other
+ * generators were available, including its slightly biased modulo draws.
+ * xoshiro256** is much smaller and faster, and its bounded draws and deals
+ * are exactly uniform.
+ */
+
+/* C / C++ / STL includes */
+#include <string.h>
+
+/* Pure CFR includes */
+#include "rng_engine.hpp"
+
+/* Advances a splitmix64 state, used to spread seeds over xoshiro's state */
+static uint64_t splitmix64_next( uint64_t &x )
+{
+  uint64_t z = ( x += 0x9e3779b97f4a7c15ULL );
+  z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+  z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+  return z ^ ( z >> 31 );
+}
+
+void rng_seed( rng_engine_t &rng, const rng_type_t type,
+	       uint32_t *seeds, const int num_seeds )
+{
+  rng.type = type;
+  switch( type ) {
+  case RNG_MT:
+    init_by_array( &rng.state.mt, seeds, num_seeds );
+    break;
+
+  case RNG_XOSHIRO:
+  default: {
+    /* Mix every seed in, so that seeds differing anywhere give unrelated
+     * streams.  splitmix64 never yields an all-zero xoshiro state.
+     */
+    uint64_t x = 0;
+    for( int i = 0; i < num_seeds; ++i ) {
+      x = splitmix64_next( x ) ^ seeds[ i ];
+    }
+    for( int i = 0; i < 4; ++i ) {
+      rng.state.xoshiro[ i ] = splitmix64_next( x );
+    }
+    break;
+  }
+  }
+}
+
+void init_deck( const Game *game, deck_t &deck )
+{
+  deck.num_cards = 0;
+  for( int s = 0; s < game->numSuits; ++s ) {
+    for( int r = 0; r < game->numRanks; ++r ) {
+      deck.cards[ deck.num_cards ] = makeCard( r, s );
+      ++deck.num_cards;
+    }
+  }
+}
+
+void rng_deal_hand( const Game *game, const deck_t &deck, rng_engine_t &rng,
+		    hand_t &hand )
+{
+  /* Each card drawn is replaced by the last card still in the deck */
+  uint8_t cards[ MAX_SUITS * MAX_RANKS ];
+  memcpy( cards, deck.cards, deck.num_cards * sizeof( cards[ 0 ] ) );
+  int num_cards = deck.num_cards;
+
+  for( int p = 0; p < game->numPlayers; ++p ) {
+    for( int i = 0; i < game->numHoleCards; ++i ) {
+      int c = rng_bounded( rng, num_cards );
+      hand.hole_cards[ p ][ i ] = cards[ c ];
+      --num_cards;
+      cards[ c ] = cards[ num_cards ];
+    }
+  }
+
+  const int num_board_cards = sumBoardCards( game, game->numRounds - 1 );
+  for( int b = 0; b < num_board_cards; ++b ) {
+    int c = rng_bounded( rng, num_cards );
+    hand.board_cards[ b ] = cards[ c ];
+    --num_cards;
+    cards[ c ] = cards[ num_cards ];
+  }
+}
@@ -0,0 +1,99 @@
+#ifndef __PURE_CFR_RNG_ENGINE_HPP__
+#define __PURE_CFR_RNG_ENGINE_HPP__
+
+/* rng_engine.hpp
+ * Random number generators used by the worker threads.  The Mersenne
+ * Twister from the ACPC server code reproduces runs made before other
+ * generators were available, including its slightly biased modulo draws.
+ * xoshiro256** is much smaller and faster, and its bounded draws and deals
+ * are exactly uniform.
+ */
+
+/* C / C++ / STL includes */
+#include <stdint.h>
+
+/* C project_acpc_server includes */
+extern "C" {
+#include "acpc_server_code/game.h"
+#include "acpc_server_code/rng.h"
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "hand.hpp"
+
+typedef struct {
+  rng_type_t type;
+  union {
+    rng_state_t mt; /* RNG_MT */
+    uint64_t xoshiro[ 4 ]; /* RNG_XOSHIRO */
+  } state;
+} rng_engine_t;
+
+/* Seeds the generator of the given type.  For RNG_MT this is the same as
+ * init_by_array, so old runs are reproduced exactly.
+ */
+void rng_seed( rng_engine_t &rng, const rng_type_t type,
+	       uint32_t *seeds, const int num_seeds );
+
+/* A game's deck, laid out in the order dealCards uses */
+typedef struct {
+  uint8_t cards[ MAX_SUITS * MAX_RANKS ];
+  int num_cards;
+} deck_t;
+
+void init_deck( const Game *game, deck_t &deck );
+
+/* Deals the hole and board cards straight into hand with a partial
+ * Fisher-Yates shuffle of a copy of deck.  The draws and the cards they
+ * pick are the same as dealCards with RNG_MT, so old runs are reproduced.
+ */
+void rng_deal_hand( const Game *game, const deck_t &deck, rng_engine_t &rng,
+		    hand_t &hand );
+
+static inline uint64_t rotl64( const uint64_t x, const int k )
+{
+  return ( x << k ) | ( x >> ( 64 - k ) );
+}
+
+static inline uint64_t xoshiro_next( uint64_t *s )
+{
+  const uint64_t result = rotl64( s[ 1 ] * 5, 7 ) * 9;
+  const uint64_t t = s[ 1 ] << 17;
+
+  s[ 2 ] ^= s[ 0 ];
+  s[ 3 ] ^= s[ 1 ];
+  s[ 1 ] ^= s[ 2 ];
+  s[ 0 ] ^= s[ 3 ];
+  s[ 2 ] ^= t;
+  s[ 3 ] = rotl64( s[ 3 ], 45 );
+
+  return result;
+}
+
+/* Returns a number drawn from [ 0, bound ), where bound > 0.  RNG_MT draws
+ * exactly as earlier versions did, with a 32-bit draw modulo bound, which
+ * favours small values and cannot reach values at or above 2^32.
+ * RNG_XOSHIRO is exactly uniform for any 64-bit bound, using Lemire's
+ * multiply-and-reject method, which rarely needs a second draw.
+ */
+static inline uint64_t rng_bounded( rng_engine_t &rng, const uint64_t bound )
+{
+  if( rng.type == RNG_MT ) {
+    return genrand_int32( &rng.state.mt ) % bound;
+  }
+
+  __uint128_t m = ( __uint128_t ) xoshiro_next( rng.state.xoshiro ) * bound;
+  uint64_t low = ( uint64_t ) m;
+  if( low < bound ) {
+    /* Reject the 2^64 mod bound values that would bias the result */
+    const uint64_t threshold = -bound % bound;
+    while( low < threshold ) {
+      m = ( __uint128_t ) xoshiro_next( rng.state.xoshiro ) * bound;
+      low = ( uint64_t ) m;
+    }
+  }
+  return ( uint64_t ) ( m >> 64 );
+}
+
+#endif
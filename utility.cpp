@@ -134,6 +134,23 @@ void time_seconds_to_string( int time, char *str, int strlen )
   }
 }
 
+void bytes_to_string( uint64_t bytes, char *str, int strlen )
+{
+  const char units[ 5 ][ 3 ] = { "B", "KB", "MB", "GB", "TB" };
+  double val = bytes;
+  int u = 0;
+  while( ( val >= 1024 ) && ( u < 4 ) ) {
+    val /= 1024;
+    ++u;
+  }
+
+  if( u == 0 ) {
+    snprintf( str, strlen, "%ju B", ( uintmax_t ) bytes );
+  } else {
+    snprintf( str, strlen, "%.2lf %s", val, units[ u ] );
+  }
+}
+
 int get_next_token( char out[ PATH_LENGTH ], const char *str )
 {
   /* Skip whitespace */